@@ -0,0 +1,511 @@
+#include "arenasoup.h"
+#include <QDebug>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+bool equalsIgnoreCase(QByteArrayView a, QByteArrayView b) {
+    return a.size() == b.size() && qstrnicmp(a.data(), a.size(), b.data(), b.size()) == 0;
+}
+
+bool isOneOf(QByteArrayView name, std::initializer_list<const char *> names) {
+    for (auto candidate : names) {
+        if (equalsIgnoreCase(name, candidate)) return true;
+    }
+    return false;
+}
+
+bool isVoidElement(QByteArrayView name) {
+    return isOneOf(name, {"area", "base", "br", "col", "embed", "hr", "img", "input", "link", "meta", "param", "source", "track", "wbr"});
+}
+
+bool isRawTextElement(QByteArrayView name) {
+    return isOneOf(name, {"script", "style", "textarea", "title"});
+}
+
+// Elements whose start tag implicitly ends an open sibling of the same kind, like <li> after <li>
+bool closesSibling(QByteArrayView name, QByteArrayView open) {
+    if (isOneOf(name, {"td", "th"})) return isOneOf(open, {"td", "th"});
+    if (isOneOf(name, {"dt", "dd"})) return isOneOf(open, {"dt", "dd"});
+    if (isOneOf(name, {"li", "p", "option", "tr"})) return equalsIgnoreCase(name, open);
+    return false;
+}
+}
+
+ArenaSoup::ArenaSoup(const QByteArray &htmlContent) : m_source(htmlContent) {
+    build();
+}
+
+quint32 ArenaSoup::append(Entry entry, quint32 parent) {
+    auto index = static_cast<quint32>(m_entries.size());
+    entry.parent = parent;
+    m_entries.push_back(entry);
+    if (parent != none && entry.type != Entry::Attribute) {
+        Entry &parentEntry = m_entries[parent];
+        if (parentEntry.lastChild == none) parentEntry.firstChild = index;
+        else m_entries[parentEntry.lastChild].nextSibling = index;
+        parentEntry.lastChild = index;
+    }
+    return index;
+}
+
+void ArenaSoup::appendText(qsizetype start, qsizetype end, quint32 parent) {
+    const char *s = m_source.constData();
+    // Whitespace between tags is dropped, libxml2 ignores most of it as well
+    qsizetype i = start;
+    while (i < end && isSpace(s[i])) i++;
+    if (i == end) return;
+    Entry text;
+    text.type = Entry::Text;
+    text.valueOffset = static_cast<quint32>(start);
+    text.valueLength = static_cast<quint32>(end - start);
+    append(text, parent);
+}
+
+void ArenaSoup::build() {
+    const char *s = m_source.constData();
+    const qsizetype n = m_source.size();
+    // Real pages average a few dozen bytes per node, reserving up front keeps the array from regrowing
+    m_entries.reserve(static_cast<size_t>(n / 24) + 16);
+    m_entries.push_back(Entry());
+
+    QVarLengthArray<quint32, 64> stack;
+    stack.append(root);
+    qsizetype pos = 0;
+
+    auto findIgnoreCase = [&](qsizetype from, QByteArrayView needle) -> qsizetype {
+        for (qsizetype i = from; i + needle.size() <= n; ++i) {
+            if (qstrnicmp(s + i, needle.size(), needle.data(), needle.size()) == 0) return i;
+        }
+        return -1;
+    };
+
+    while (pos < n) {
+        if (s[pos] != '<' || pos + 1 >= n) {
+            qsizetype end = m_source.indexOf('<', pos + 1);
+            if (end < 0) end = n;
+            appendText(pos, end, stack.last());
+            pos = end;
+            continue;
+        }
+
+        char next = s[pos + 1];
+        if (next == '!' || next == '?') {
+            // Comments, doctype and processing instructions carry nothing the providers query
+            qsizetype end = qstrncmp(s + pos, "<!--", 4) == 0 ? m_source.indexOf("-->", pos + 4) : m_source.indexOf('>', pos + 2);
+            pos = end < 0 ? n : end + (s[end] == '-' ? 3 : 1);
+            continue;
+        }
+
+        if (next == '/') {
+            qsizetype nameStart = pos + 2;
+            qsizetype nameEnd = nameStart;
+            while (nameEnd < n && !isSpace(s[nameEnd]) && s[nameEnd] != '>') nameEnd++;
+            QByteArrayView name(s + nameStart, nameEnd - nameStart);
+            qsizetype end = m_source.indexOf('>', nameEnd);
+            pos = end < 0 ? n : end + 1;
+            // Unmatched end tags are ignored, matched ones also close everything left open inside
+            for (qsizetype i = stack.size() - 1; i > 0; --i) {
+                if (equalsIgnoreCase(nameOf(stack[i]), name)) {
+                    stack.resize(i);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if (!std::isalpha(static_cast<unsigned char>(next))) {
+            // A stray '<' is plain text
+            qsizetype end = m_source.indexOf('<', pos + 1);
+            if (end < 0) end = n;
+            appendText(pos, end, stack.last());
+            pos = end;
+            continue;
+        }
+
+        qsizetype nameStart = pos + 1;
+        qsizetype nameEnd = nameStart;
+        while (nameEnd < n && !isSpace(s[nameEnd]) && s[nameEnd] != '>' && s[nameEnd] != '/') nameEnd++;
+        QByteArrayView name(s + nameStart, nameEnd - nameStart);
+        if (stack.size() > 1 && closesSibling(name, nameOf(stack.last())))
+            stack.removeLast();
+
+        Entry element;
+        element.nameOffset = static_cast<quint32>(nameStart);
+        element.nameLength = static_cast<quint32>(nameEnd - nameStart);
+        quint32 index = append(element, stack.last());
+
+        bool selfClosing = false;
+        pos = nameEnd;
+        while (pos < n) {
+            while (pos < n && isSpace(s[pos])) pos++;
+            if (pos >= n) break;
+            if (s[pos] == '>') {
+                pos++;
+                break;
+            }
+            if (s[pos] == '/') {
+                selfClosing = true;
+                pos++;
+                continue;
+            }
+            qsizetype attrStart = pos;
+            while (pos < n && !isSpace(s[pos]) && s[pos] != '=' && s[pos] != '>' && s[pos] != '/') pos++;
+            if (pos == attrStart) {
+                pos++;
+                continue;
+            }
+            Entry attribute;
+            attribute.type = Entry::Attribute;
+            attribute.nameOffset = static_cast<quint32>(attrStart);
+            attribute.nameLength = static_cast<quint32>(pos - attrStart);
+            while (pos < n && isSpace(s[pos])) pos++;
+            if (pos < n && s[pos] == '=') {
+                pos++;
+                while (pos < n && isSpace(s[pos])) pos++;
+                if (pos < n && (s[pos] == '"' || s[pos] == '\'')) {
+                    qsizetype end = m_source.indexOf(s[pos], pos + 1);
+                    if (end < 0) end = n;
+                    attribute.valueOffset = static_cast<quint32>(pos + 1);
+                    attribute.valueLength = static_cast<quint32>(end - pos - 1);
+                    pos = std::min(end + 1, n);
+                } else {
+                    qsizetype valueStart = pos;
+                    while (pos < n && !isSpace(s[pos]) && s[pos] != '>') pos++;
+                    attribute.valueOffset = static_cast<quint32>(valueStart);
+                    attribute.valueLength = static_cast<quint32>(pos - valueStart);
+                }
+            }
+            append(attribute, index);
+            m_entries[index].attrCount++;
+        }
+
+        if (selfClosing || isVoidElement(name)) continue;
+        if (isRawTextElement(name)) {
+            // Script and style bodies may contain '<', take everything up to the matching end tag as text
+            QByteArray endTag = "</" + name.toByteArray();
+            qsizetype end = findIgnoreCase(pos, endTag);
+            if (end < 0) end = n;
+            appendText(pos, end, index);
+            pos = end;
+        }
+        stack.append(index);
+    }
+}
+
+std::optional<ArenaSoup::Path> ArenaSoup::parsePath(const QString &xpathExpr) {
+    QByteArray expr = xpathExpr.trimmed().toUtf8();
+    Path path;
+    qsizetype pos = 0;
+    if (expr.startsWith('/')) {
+        path.absolute = true;
+    } else if (expr.startsWith('.')) {
+        pos = 1;
+    } else {
+        // A bare step like "a" is relative to the context node
+        expr.prepend("./");
+        pos = 1;
+    }
+
+    auto isNameChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_'; };
+    auto readName = [&]() {
+        qsizetype start = pos;
+        while (pos < expr.size() && isNameChar(expr[pos])) pos++;
+        return expr.mid(start, pos - start);
+    };
+    auto readQuoted = [&](QByteArray &out) {
+        if (pos >= expr.size() || (expr[pos] != '\'' && expr[pos] != '"')) return false;
+        qsizetype end = expr.indexOf(expr[pos], pos + 1);
+        if (end < 0) return false;
+        out = expr.mid(pos + 1, end - pos - 1);
+        pos = end + 1;
+        return true;
+    };
+
+    while (pos < expr.size()) {
+        Step step;
+        if (expr.mid(pos, 2) == "//") {
+            step.descendant = true;
+            pos += 2;
+        } else if (expr[pos] == '/') {
+            pos += 1;
+        } else {
+            return std::nullopt;
+        }
+
+        if (expr.mid(pos, 6) == "text()") {
+            step.test = Step::Text;
+            pos += 6;
+        } else if (pos < expr.size() && expr[pos] == '*') {
+            step.test = Step::Any;
+            pos++;
+        } else {
+            step.name = readName();
+            if (step.name.isEmpty()) return std::nullopt;
+        }
+
+        while (pos < expr.size() && expr[pos] == '[') {
+            pos++;
+            Predicate predicate;
+            if (expr.mid(pos, 6) == "last()") {
+                predicate.kind = Predicate::Last;
+                pos += 6;
+            } else if (pos < expr.size() && std::isdigit(static_cast<unsigned char>(expr[pos]))) {
+                qsizetype start = pos;
+                while (pos < expr.size() && std::isdigit(static_cast<unsigned char>(expr[pos]))) pos++;
+                predicate.kind = Predicate::Position;
+                predicate.position = expr.mid(start, pos - start).toInt();
+            } else if (expr.mid(pos, 10) == "contains(@") {
+                pos += 10;
+                predicate.kind = Predicate::AttrContains;
+                predicate.attr = readName();
+                while (pos < expr.size() && (expr[pos] == ',' || expr[pos] == ' ')) pos++;
+                if (predicate.attr.isEmpty() || !readQuoted(predicate.value)) return std::nullopt;
+                if (pos >= expr.size() || expr[pos] != ')') return std::nullopt;
+                pos++;
+            } else if (pos < expr.size() && expr[pos] == '@') {
+                pos++;
+                predicate.attr = readName();
+                if (predicate.attr.isEmpty()) return std::nullopt;
+                if (pos < expr.size() && expr[pos] == '=') {
+                    pos++;
+                    predicate.kind = Predicate::AttrEquals;
+                    if (!readQuoted(predicate.value)) return std::nullopt;
+                } else {
+                    predicate.kind = Predicate::HasAttr;
+                }
+            } else {
+                return std::nullopt;
+            }
+            if (pos >= expr.size() || expr[pos] != ']') return std::nullopt;
+            pos++;
+            step.predicates.append(predicate);
+        }
+        path.steps.append(step);
+    }
+    return path;
+}
+
+bool ArenaSoup::matches(const Step &step, quint32 index) const {
+    const Entry &entry = m_entries[index];
+    switch (step.test) {
+    case Step::Text:
+        return entry.type == Entry::Text;
+    case Step::Any:
+        return entry.type == Entry::Element;
+    case Step::Name:
+        return entry.type == Entry::Element && equalsIgnoreCase(nameOf(index), step.name);
+    }
+    return false;
+}
+
+bool ArenaSoup::matches(const Predicate &predicate, quint32 index, int position, int size) const {
+    switch (predicate.kind) {
+    case Predicate::Position:
+        return position == predicate.position;
+    case Predicate::Last:
+        return position == size;
+    case Predicate::HasAttr:
+        return findAttr(index, QLatin1StringView(predicate.attr)) != none;
+    case Predicate::AttrEquals:
+    case Predicate::AttrContains: {
+        quint32 attr = findAttr(index, QLatin1StringView(predicate.attr));
+        if (attr == none) return false;
+        QByteArrayView raw = valueOf(attr);
+        // Only decode when the value actually contains an entity
+        QByteArray decoded = raw.contains('&') ? decode(raw).toUtf8() : QByteArray();
+        QByteArrayView value = decoded.isNull() ? raw : QByteArrayView(decoded);
+        return predicate.kind == Predicate::AttrEquals ? value == predicate.value : value.contains(predicate.value);
+    }
+    }
+    return false;
+}
+
+QVector<quint32> ArenaSoup::evaluate(quint32 context, const QString &xpathExpr) const {
+    // Paths are parsed once per thread, provider loops reuse the same handful of expressions
+    thread_local QHash<QString, std::optional<Path>> parsedPaths;
+    auto it = parsedPaths.find(xpathExpr);
+    if (it == parsedPaths.end()) {
+        if (parsedPaths.size() > 1024) parsedPaths.clear();
+        it = parsedPaths.insert(xpathExpr, parsePath(xpathExpr));
+    }
+    if (!*it) {
+        qWarning() << "Log (ArenaSoup): Unsupported XPath" << xpathExpr;
+        return {};
+    }
+    const Path &path = **it;
+
+    QVector<quint32> current{path.absolute ? root : context};
+    QVector<quint32> parents;
+    QVector<quint32> candidates;
+    for (const auto &step : path.steps) {
+        QVector<quint32> next;
+        for (quint32 contextIndex : std::as_const(current)) {
+            // descendant-or-self::node()/child::step, so positional predicates count per parent as in XPath
+            parents.clear();
+            parents.append(contextIndex);
+            if (step.descendant) {
+                for (qsizetype i = 0; i < parents.size(); ++i) {
+                    for (quint32 child = m_entries[parents[i]].firstChild; child != none; child = m_entries[child].nextSibling) {
+                        if (m_entries[child].type == Entry::Element) parents.append(child);
+                    }
+                }
+            }
+            for (quint32 parent : std::as_const(parents)) {
+                candidates.clear();
+                for (quint32 child = m_entries[parent].firstChild; child != none; child = m_entries[child].nextSibling) {
+                    if (matches(step, child)) candidates.append(child);
+                }
+                for (const auto &predicate : step.predicates) {
+                    QVector<quint32> filtered;
+                    const int size = static_cast<int>(candidates.size());
+                    for (int i = 0; i < size; ++i) {
+                        if (matches(predicate, candidates[i], i + 1, size)) filtered.append(candidates[i]);
+                    }
+                    candidates.swap(filtered);
+                }
+                next.append(candidates);
+            }
+        }
+        // Index order is document order, overlapping contexts can produce the same node twice
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+        current.swap(next);
+        if (current.isEmpty()) break;
+    }
+    return current;
+}
+
+quint32 ArenaSoup::findAttr(quint32 index, QLatin1StringView attrName) const {
+    const Entry &entry = m_entries[index];
+    if (entry.type != Entry::Element) return none;
+    for (quint32 attr = index + 1; attr <= index + entry.attrCount; ++attr) {
+        QByteArrayView name = nameOf(attr);
+        if (name.size() == attrName.size() && qstrnicmp(name.data(), name.size(), attrName.data(), attrName.size()) == 0)
+            return attr;
+    }
+    return none;
+}
+
+QString ArenaSoup::decode(QByteArrayView raw) {
+    if (!raw.contains('&')) return QString::fromUtf8(raw);
+    static const QHash<QByteArray, QChar> named {
+        {"amp", u'&'}, {"lt", u'<'}, {"gt", u'>'}, {"quot", u'"'}, {"apos", u'\''}, {"nbsp", QChar(0xA0)},
+    };
+    QString decoded;
+    decoded.reserve(raw.size());
+    qsizetype pos = 0;
+    while (pos < raw.size()) {
+        qsizetype amp = raw.indexOf('&', pos);
+        if (amp < 0) amp = raw.size();
+        decoded += QString::fromUtf8(raw.sliced(pos, amp - pos));
+        if (amp == raw.size()) break;
+        qsizetype semicolon = raw.indexOf(';', amp);
+        if (semicolon < 0 || semicolon - amp > 10) {
+            decoded += u'&';
+            pos = amp + 1;
+            continue;
+        }
+        QByteArrayView entity = raw.sliced(amp + 1, semicolon - amp - 1);
+        bool ok = false;
+        if (entity.startsWith('#')) {
+            uint code = entity.size() > 1 && (entity[1] == 'x' || entity[1] == 'X')
+                ? entity.sliced(2).toByteArray().toUInt(&ok, 16) : entity.sliced(1).toByteArray().toUInt(&ok, 10);
+            if (ok) {
+                char32_t codePoint = code;
+                decoded += QString::fromUcs4(&codePoint, 1);
+            }
+        } else if (auto it = named.find(entity.toByteArray()); it != named.end()) {
+            decoded += *it;
+            ok = true;
+        }
+        if (!ok) decoded += QString::fromUtf8(raw.sliced(amp, semicolon - amp + 1));
+        pos = semicolon + 1;
+    }
+    return decoded;
+}
+
+ArenaSoup::Node ArenaSoup::Node::selectNth(const QString &xpathExpr, int n, bool reversed) const {
+    if (!*this || n < 0) return Node();
+    auto indices = m_soup->evaluate(m_index, xpathExpr);
+    if (n >= indices.size()) return Node();
+    return Node(m_soup, indices[reversed ? indices.size() - 1 - n : n]);
+}
+
+QVector<ArenaSoup::Node> ArenaSoup::Node::select(const QString &xpathExpr) const {
+    if (!*this) return {};
+    QVector<Node> nodes;
+    const auto indices = m_soup->evaluate(m_index, xpathExpr);
+    nodes.reserve(indices.size());
+    for (auto index : indices) {
+        nodes.emplaceBack(m_soup, index);
+    }
+    return nodes;
+}
+
+QUtf8StringView ArenaSoup::Node::name() const {
+    if (!*this) return {};
+    auto name = m_soup->nameOf(m_index);
+    return QUtf8StringView(name.data(), name.size());
+}
+
+QUtf8StringView ArenaSoup::Node::textView() const {
+    if (!*this) return {};
+    const auto &entries = m_soup->m_entries;
+    quint32 text = m_index;
+    if (entries[text].type == Entry::Element) {
+        text = entries[m_index].firstChild;
+        if (text == none) return QUtf8StringView("");
+        if (entries[text].type != Entry::Text || entries[text].nextSibling != none) return {};
+    }
+    auto value = m_soup->valueOf(text);
+    if (value.contains('&')) return {};
+    return QUtf8StringView(value.data(), value.size());
+}
+
+QString ArenaSoup::Node::text() const {
+    if (!*this) return "";
+    if (auto view = textView(); !view.isNull()) return view.toString();
+    const auto &entries = m_soup->m_entries;
+    if (entries[m_index].type == Entry::Text) return decode(m_soup->valueOf(m_index));
+    // Concatenate every text node of the subtree, like xmlNodeGetContent
+    QString content;
+    QVarLengthArray<quint32, 32> stack;
+    stack.append(m_index);
+    while (!stack.isEmpty()) {
+        quint32 index = stack.takeLast();
+        if (entries[index].type == Entry::Text) {
+            content += decode(m_soup->valueOf(index));
+            continue;
+        }
+        QVarLengthArray<quint32, 16> children;
+        for (quint32 child = entries[index].firstChild; child != none; child = entries[child].nextSibling) {
+            children.append(child);
+        }
+        for (qsizetype i = children.size() - 1; i >= 0; --i) {
+            stack.append(children[i]);
+        }
+    }
+    return content;
+}
+
+QUtf8StringView ArenaSoup::Node::attrView(QLatin1StringView attrName) const {
+    if (!*this) return {};
+    quint32 attr = m_soup->findAttr(m_index, attrName);
+    if (attr == none) return {};
+    auto value = m_soup->valueOf(attr);
+    if (value.contains('&')) return {};
+    return QUtf8StringView(value.data(), value.size());
+}
+
+QString ArenaSoup::Node::attr(QLatin1StringView attrName) const {
+    if (!*this) return "";
+    quint32 attr = m_soup->findAttr(m_index, attrName);
+    if (attr == none) return "";
+    return decode(m_soup->valueOf(attr));
+}
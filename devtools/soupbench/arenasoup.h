@@ -0,0 +1,133 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QLatin1StringView>
+#include <QString>
+#include <QUtf8StringView>
+#include <QVector>
+#include <optional>
+#include <vector>
+
+// Experimental HTML backend with the CSoup query surface, built only with the benchmark and not part of the app.
+// A tolerant tokenizer builds a flat DOM in one contiguous array whose names, text and attribute values are
+// slices of the source buffer. Freeing a document releases two buffers, that array and the source, instead of
+// one allocation per node and string.
+// Queries support the XPath subset the providers use: absolute and relative / and // steps, name, *
+// and text() tests, and [@a], [@a='v'], [contains(@a,'v')], [n] and [last()] predicates
+class ArenaSoup {
+    struct Entry;
+public:
+    static ArenaSoup parse(const QByteArray &htmlContent) {
+        return ArenaSoup(htmlContent);
+    }
+
+    // Nodes point into the soup, like CSoup::NodeRef they must not outlive it
+    ArenaSoup(const ArenaSoup&) = delete;
+    ArenaSoup& operator=(const ArenaSoup&) = delete;
+    ArenaSoup(ArenaSoup&&) = delete;
+    ArenaSoup& operator=(ArenaSoup&&) = delete;
+
+    struct Node {
+        Node(const ArenaSoup *soup = nullptr, quint32 index = none) : m_soup(soup), m_index(index) {}
+
+        inline Node selectFirst(const QString &xpathExpr) const {
+            return selectNth(xpathExpr, 0);
+        }
+        inline Node selectLast(const QString &xpathExpr) const {
+            return selectNth(xpathExpr, 0, true);
+        }
+        Node selectNth(const QString &xpathExpr, int n, bool reversed = false) const;
+        QVector<Node> select(const QString &xpathExpr) const;
+
+        QString text() const;
+        QString attr(const QString &attrName) const { return attr(QLatin1StringView(attrName.toLatin1())); }
+        QString attr(QLatin1StringView attrName) const;
+        QString attr(const char *attrName) const { return attr(QLatin1StringView(attrName)); }
+        // Views into the source buffer, null when the value needs entity decoding or spans several nodes
+        QUtf8StringView textView() const;
+        QUtf8StringView attrView(QLatin1StringView attrName) const;
+        QUtf8StringView name() const;
+
+        explicit operator bool() const { return m_soup && m_index != none; }
+
+    private:
+        friend class ArenaSoup;
+        const ArenaSoup *m_soup = nullptr;
+        quint32 m_index = none;
+    };
+
+    inline Node selectFirst(const QString &xpathExpr) const {
+        return selectNth(xpathExpr, 0);
+    }
+    inline Node selectLast(const QString &xpathExpr) const {
+        return selectNth(xpathExpr, 0, true);
+    }
+    Node selectNth(const QString &xpathExpr, int n, bool reversed = false) const {
+        return Node(this, root).selectNth(xpathExpr, n, reversed);
+    }
+    QVector<Node> select(const QString &xpathExpr) const {
+        return Node(this, root).select(xpathExpr);
+    }
+
+    explicit operator bool() const { return m_entries.size() > 1; }
+    qsizetype nodeCount() const { return static_cast<qsizetype>(m_entries.size()); }
+
+private:
+    explicit ArenaSoup(const QByteArray &htmlContent);
+
+    inline static constexpr quint32 none = 0xFFFFFFFF;
+    inline static constexpr quint32 root = 0;
+
+    // Elements, text and attributes share the array. An element's attributes directly follow it,
+    // its children are linked through firstChild/nextSibling, so index order is document order
+    struct Entry {
+        enum Type : quint8 { Element, Text, Attribute };
+        Type type = Element;
+        quint16 attrCount = 0;
+        quint32 parent = none;
+        quint32 firstChild = none;
+        quint32 lastChild = none;
+        quint32 nextSibling = none;
+        quint32 nameOffset = 0;
+        quint32 nameLength = 0;
+        quint32 valueOffset = 0;
+        quint32 valueLength = 0;
+    };
+
+    struct Predicate {
+        enum Kind { HasAttr, AttrEquals, AttrContains, Position, Last };
+        Kind kind;
+        QByteArray attr;
+        QByteArray value;
+        int position = 0;
+    };
+    struct Step {
+        bool descendant = false;  // Preceded by // so every descendant of the context is a parent candidate
+        enum Test { Name, Any, Text } test = Name;
+        QByteArray name;
+        QList<Predicate> predicates;
+    };
+    struct Path {
+        bool absolute = false;
+        QList<Step> steps;
+    };
+
+    void build();
+    quint32 append(Entry entry, quint32 parent);
+    void appendText(qsizetype start, qsizetype end, quint32 parent);
+    QVector<quint32> evaluate(quint32 context, const QString &xpathExpr) const;
+    bool matches(const Step &step, quint32 index) const;
+    bool matches(const Predicate &predicate, quint32 index, int position, int size) const;
+    static std::optional<Path> parsePath(const QString &xpathExpr);
+
+    QByteArrayView slice(quint32 offset, quint32 length) const {
+        return QByteArrayView(m_source.constData() + offset, length);
+    }
+    QByteArrayView nameOf(quint32 index) const { return slice(m_entries[index].nameOffset, m_entries[index].nameLength); }
+    QByteArrayView valueOf(quint32 index) const { return slice(m_entries[index].valueOffset, m_entries[index].valueLength); }
+    quint32 findAttr(quint32 index, QLatin1StringView attrName) const;
+    static QString decode(QByteArrayView raw);
+
+    QByteArray m_source;
+    std::vector<Entry> m_entries;
+};
@@ -0,0 +1,77 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include "arenasoup.h"
+#include "network/csoup.h"
+
+// Queries shaped like the ones the providers run on listing and detail pages
+static const QStringList queries = {
+    "//a[@href]",
+    "//ul[@class='items']/li",
+    "//div[@class='module-items']/div",
+    "//img",
+};
+
+template <typename Soup>
+static qsizetype runQueries(const Soup &soup) {
+    qsizetype matches = 0;
+    for (const auto &query : queries) {
+        for (const auto &node : soup.select(query)) {
+            matches += node.attr("href").size() > 0;
+        }
+    }
+    return matches;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    if (argc < 2) {
+        out << "usage: soupbench <folder of saved .html pages> [iterations]\n";
+        return 1;
+    }
+    const QDir dir(QString::fromLocal8Bit(argv[1]));
+    const int iterations = argc > 2 ? QByteArray(argv[2]).toInt() : 50;
+    xmlInitParser();
+
+    out << QString("%1 %2 %3 %4 %5 %6\n").arg("page", -32).arg("KiB", 8).arg("libxml2 ms", 12)
+               .arg("arena ms", 12).arg("speedup", 8).arg("matches");
+    const auto files = dir.entryInfoList({"*.html", "*.htm"}, QDir::Files, QDir::Name);
+    for (const auto &fileInfo : files) {
+        QFile file(fileInfo.filePath());
+        if (!file.open(QIODevice::ReadOnly)) continue;
+        const QByteArray html = file.readAll();
+
+        // Parse, query and free, the whole lifetime of a page in a provider call
+        QElapsedTimer timer;
+        qsizetype libxmlMatches = 0;
+        timer.start();
+        for (int i = 0; i < iterations; ++i) {
+            auto soup = CSoup::parse(html);
+            libxmlMatches = runQueries(soup);
+        }
+        double libxmlMs = timer.nsecsElapsed() / 1e6 / iterations;
+
+        qsizetype arenaMatches = 0;
+        timer.restart();
+        for (int i = 0; i < iterations; ++i) {
+            auto soup = ArenaSoup::parse(html);
+            arenaMatches = runQueries(soup);
+        }
+        double arenaMs = timer.nsecsElapsed() / 1e6 / iterations;
+
+        out << QString("%1 %2 %3 %4 %5 %6/%7\n")
+                   .arg(fileInfo.fileName(), -32)
+                   .arg(html.size() / 1024, 8)
+                   .arg(libxmlMs, 12, 'f', 3)
+                   .arg(arenaMs, 12, 'f', 3)
+                   .arg(libxmlMs / arenaMs, 8, 'f', 2)
+                   .arg(libxmlMatches).arg(arenaMatches);
+    }
+
+    CSoup::cleanupXPathCache();
+    xmlCleanupParser();
+    return 0;
+}
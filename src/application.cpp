@@ -1,4 +1,5 @@
 #include "application.h"
+#include "network/httpcache.h"
 #include <QNetworkProxyFactory>
 #include <QTextCodec>
 #include <libxml2/libxml/parser.h>
@@ -50,7 +51,11 @@ Application::Application(QGuiApplication &app, const QString &launchPath,
 }
 
 Application::~Application() {
+    HttpCache::instance().waitForWrites();
+    ServerScoreboard::instance().save();
+    Client::cleanupCurls();
     curl_global_cleanup();
+    CSoup::cleanupXPathCache();
     xmlCleanupParser();
 }
 
@@ -87,6 +92,16 @@ void Application::loadShow(int index, bool fromWatchList) {
     }
 }
 
+void Application::loadShowFrom(int index, int providerIndex) {
+    if (index < 0 || index >= m_searchResultManager.count()) return;
+    const auto &result = m_searchResultManager.at(index);
+    if (providerIndex < 0 || providerIndex > result.otherProviders.size()) return;
+    ShowData show = result.withProvider(providerIndex);
+    ShowData::LastWatchInfo lastWatchedInfo = m_libraryManager.getLastWatchInfo(show.link);
+    lastWatchedInfo.playlist = m_playlistManager.findPlaylist(show.link);
+    m_showManager.setShow(show, lastWatchedInfo);
+}
+
 void Application::addCurrentShowToLibrary(int listType) {
     m_libraryManager.add(m_showManager.getShow(), listType); // Either changes the list type or adds to library
     m_showManager.setListType(listType);
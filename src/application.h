@@ -57,7 +57,16 @@ public:
             m_searchResultManager.popular(page, type, provider);
         }
         m_lastSearch = [this, query, isLatest, page](bool isReload = false) {
-            explore(query, isReload ? page : page + 1);
+            explore(query, isReload ? page : page + 1, isLatest);
+        };
+    }
+    // Searches every provider at once, results stream into the explorer as each provider answers
+    Q_INVOKABLE void exploreAll(const QString& query, int page = 1) {
+        if (query.isEmpty()) return;
+        int type = m_providerManager.getCurrentSearchType();
+        if (!m_searchResultManager.searchAll(query, page, type, m_providerManager.getProviders())) return;
+        m_lastSearch = [this, query, page](bool isReload = false) {
+            exploreAll(query, isReload ? page : page + 1);
         };
     }
     Q_INVOKABLE void exploreMore(bool isReload) {
@@ -65,6 +74,8 @@ public:
         m_lastSearch(isReload);
     }
     Q_INVOKABLE void loadShow(int index, bool fromWatchList);
+    // Opens a merged search result through one of its providers, 0 being the one it was listed under
+    Q_INVOKABLE void loadShowFrom(int index, int providerIndex);
     Q_INVOKABLE void playFromEpisodeList(int index);
     Q_INVOKABLE void continueWatching();
     Q_INVOKABLE void addCurrentShowToLibrary(int listType);
@@ -107,7 +107,8 @@ bool DownloadTask::extractLink() {
     if (m_isCancelled) {
         return false;
     }
-    PlayInfo playInfo = ServerListModel::autoSelectServer(&client, servers, m_provider);
+    // Up to 16 tasks extract at once, racing several servers for each would flood the providers
+    PlayInfo playInfo = ServerListModel::autoSelectServer(&client, servers, m_provider, "", 1);
     if (playInfo.sources.isEmpty() || m_isCancelled) {
         return false;
     }
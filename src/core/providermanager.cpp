@@ -10,6 +10,7 @@
 #include "providers/yingshi.h"
 // #include "providers/broken/fmovies.h"
 #include "providers/wco.h"
+#include "network/httpcache.h"
 
 ProviderManager::ProviderManager(QObject *parent)
     : QAbstractListModel(parent)
@@ -30,6 +31,14 @@ ProviderManager::ProviderManager(QObject *parent)
 
     for (ShowProvider* provider : m_providers) {
         m_providersMap.insert(provider->name(), provider);
+        auto ttls = provider->getCacheTtls();
+        for (auto it = ttls.constBegin(); it != ttls.constEnd(); ++it) {
+            HttpCache::instance().setTtl(it.key(), it.value());
+        }
+        auto limits = provider->getHostLimits();
+        for (auto it = limits.constBegin(); it != limits.constEnd(); ++it) {
+            Client::setHostLimits(it.key(), it.value());
+        }
     }
     setCurrentProviderIndex(0);
 }
@@ -16,6 +16,7 @@ public:
     ~ProviderManager() { qDeleteAll (m_providers); }
     Q_INVOKABLE void cycleProviders();
     ShowProvider *getCurrentSearchProvider() const { return m_currentSearchProvider; }
+    const QList<ShowProvider*> &getProviders() const { return m_providers; }
     int getCurrentSearchType() const { return m_currentSearchType; }
     static ShowProvider *getProvider(const QString& providerName) {
         if (!m_providersMap.contains (providerName)) return nullptr;
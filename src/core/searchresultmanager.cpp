@@ -14,16 +14,11 @@ SearchResultManager::SearchResultManager(QObject *parent) : QAbstractListModel(p
                 auto results = m_watcher.result();
                 m_canFetchMore = !results.isEmpty();
                 if (m_currentPage > 1) {
-                    const int oldCount = m_list.count();
-                    beginInsertRows(QModelIndex(), oldCount, oldCount + results.count() - 1);
-                    m_list.reserve(oldCount + results.count());
-                    m_list += results;
-                    endInsertRows();
+                    appendRows(results);
                 } else {
-                    m_list.reserve(results.size());
-                    m_list.swap(results);
-                    emit layoutChanged();
+                    resetRows(std::move(results));
                 }
+                if (m_canFetchMore) startPrefetch(m_currentQuery.next());
             }
             catch (const MyException& ex) {
                 ErrorHandler::instance().show (ex.what(), "Explorer myError");
@@ -34,38 +29,186 @@ SearchResultManager::SearchResultManager(QObject *parent) : QAbstractListModel(p
             }
         }
         m_isCancelled = false;
+        m_adoptedPrefetch.reset();
         setIsLoading (false);
     });
 
+    // Bounded so a search over every provider does not open a connection burst to all sites at once
+    m_federatedPool.setMaxThreadCount(4);
 }
 
 void SearchResultManager::search(const QString &query, int page, int type, ShowProvider* provider)
 {
-    if (m_watcher.isRunning()) return;
-    setIsLoading (true);
-    m_currentPage = page;
-    m_watcher.setFuture(QtConcurrent::run(&ShowProvider::search, provider, &m_client, query, page, type));
+    load({Query::Search, query, page, type, provider});
 }
 
 void SearchResultManager::latest(int page, int type, ShowProvider* provider)
 {
-    if (m_watcher.isRunning()) return;
-    setIsLoading (true);
-    m_currentPage = page;
-    m_watcher.setFuture(QtConcurrent::run(&ShowProvider::latest, provider, &m_client, page, type));
+    load({Query::Latest, QString(), page, type, provider});
 }
 
 void SearchResultManager::popular(int page, int type, ShowProvider* provider){
+    load({Query::Popular, QString(), page, type, provider});
+}
+
+QFuture<QList<ShowData>> SearchResultManager::run(const Query &query, Client *client) {
+    switch (query.kind) {
+    case Query::Search:
+        return QtConcurrent::run(&ShowProvider::search, query.provider, client, query.text, query.page, query.type);
+    case Query::Latest:
+        return QtConcurrent::run(&ShowProvider::latest, query.provider, client, query.page, query.type);
+    case Query::Popular:
+        return QtConcurrent::run(&ShowProvider::popular, query.provider, client, query.page, query.type);
+    }
+    Q_UNREACHABLE();
+}
+
+void SearchResultManager::load(const Query &query) {
     if (m_watcher.isRunning()) return;
+    // A federated search still streaming in would otherwise append into the list this query replaces
+    cancelFederated();
     setIsLoading (true);
+    m_currentPage = query.page;
+    m_currentQuery = query;
+    if (m_prefetch && m_prefetch->query == query && !m_prefetch->isCancelled) {
+        // Already fetched or on its way, the watcher reports a finished future straight away
+        qDebug() << "Log (Explorer): Using prefetched page" << query.page;
+        m_adoptedPrefetch = std::move(m_prefetch);
+        m_watcher.setFuture(m_adoptedPrefetch->future);
+        return;
+    }
+    cancelPrefetch();
+    m_watcher.setFuture(run(query, &m_client));
+}
+
+void SearchResultManager::startPrefetch(const Query &query) {
+    cancelPrefetch();
+    auto prefetch = std::make_shared<Prefetch>();
+    prefetch->query = query;
+    // The task keeps the prefetch alive so its client outlives a cancelled buffer
+    prefetch->future = run(query, &prefetch->client).then([prefetch](const QList<ShowData> &results) {
+        return results;
+    });
+    m_prefetch = prefetch;
+}
+
+void SearchResultManager::cancelPrefetch() {
+    if (!m_prefetch) return;
+    m_prefetch->isCancelled = true;
+    m_prefetch.reset();
+}
+
+bool SearchResultManager::searchAll(const QString &query, int page, int type, const QList<ShowProvider*> &providers) {
+    if (m_watcher.isRunning() || m_federatedPending > 0 || providers.isEmpty()) return false;
+    cancelPrefetch();
+    int generation = ++m_federatedGeneration;
+    m_federatedTasks.clear();
     m_currentPage = page;
-    m_watcher.setFuture(QtConcurrent::run(&ShowProvider::popular, provider, &m_client, page, type));
+    m_canFetchMore = false;
+    if (page <= 1) resetRows({});
+    setIsLoading (true);
+    m_federatedPending = providers.size();
+
+    for (auto provider : providers) {
+        auto types = provider->getAvailableTypes();
+        int providerType = types.contains(type) || types.isEmpty() ? type : types.first();
+        auto task = std::make_shared<FederatedTask>();
+        task->providerName = provider->name();
+        m_federatedTasks.append(task);
+
+        QtConcurrent::run(&m_federatedPool, [this, task, generation, provider, query, page, providerType]() {
+            if (task->isCancelled) return QList<ShowData>();
+            // The deadline counts from when the provider starts, not from the time it spent queued in the pool
+            QMetaObject::invokeMethod(this, [this, task, generation](){
+                QTimer::singleShot(m_federatedDeadline, this, [this, task, generation](){
+                    if (task->isDone) return;
+                    qDebug() << "Log (Explorer): " << task->providerName << "missed the search deadline";
+                    task->isCancelled = true;
+                    finishFederatedTask(task, generation, {});
+                });
+            }, Qt::QueuedConnection);
+            try {
+                return provider->search(&task->client, query, page, providerType);
+            } catch (const std::exception &ex) {
+                if (!task->isCancelled)
+                    qDebug() << "Log (Explorer): " << task->providerName << "search failed:" << ex.what();
+            } catch (...) {
+                qDebug() << "Log (Explorer): " << task->providerName << "search failed";
+            }
+            return QList<ShowData>();
+        }).then(this, [this, task, generation](const QList<ShowData> &results) {
+            finishFederatedTask(task, generation, results);
+        });
+    }
+    return true;
+}
+
+void SearchResultManager::finishFederatedTask(const std::shared_ptr<FederatedTask> &task, int generation, const QList<ShowData> &results) {
+    if (task->isDone || generation != m_federatedGeneration) return;
+    task->isDone = true;
+    if (!results.isEmpty() && !task->isCancelled) {
+        m_canFetchMore = true;
+        QList<ShowData> newShows;
+        for (const auto &show : results) {
+            bool isNew = false;
+            int entry = m_showIndex.insert(show.title, show.provider, &isNew);
+            if (isNew) {
+                m_rowOfEntry.append(m_list.count() + newShows.count());
+                newShows.append(show);
+                continue;
+            }
+            // resetRows clears the index with the list and rows are only ever appended, so every entry has a row
+            Q_ASSERT(entry < m_rowOfEntry.size());
+            int row = m_rowOfEntry.at(entry);
+            Q_ASSERT(row < m_list.count() + newShows.count());
+            auto &merged = row < m_list.count() ? m_list[row] : newShows[row - m_list.count()];
+            merged.otherProviders.append({show.provider, show.link, show.title});
+            if (row < m_list.count())
+                emit dataChanged(index(row), index(row), {ProvidersRole});
+        }
+        appendRows(newShows);
+    }
+    if (--m_federatedPending == 0) {
+        m_federatedTasks.clear();
+        setIsLoading (false);
+    }
+}
+
+void SearchResultManager::resetRows(QList<ShowData> shows) {
+    beginResetModel();
+    m_list.swap(shows);
+    m_showIndex.clear();
+    m_rowOfEntry.clear();
+    endResetModel();
+}
+
+void SearchResultManager::appendRows(const QList<ShowData> &shows) {
+    if (shows.isEmpty()) return;
+    const int oldCount = m_list.count();
+    beginInsertRows(QModelIndex(), oldCount, oldCount + shows.count() - 1);
+    m_list += shows;
+    endInsertRows();
+}
+
+void SearchResultManager::cancelFederated() {
+    if (m_federatedPending == 0) return;
+    for (const auto &task : std::as_const(m_federatedTasks)) {
+        task->isCancelled = true;
+    }
+    m_federatedTasks.clear();
+    // Late results carry the old generation and are dropped
+    ++m_federatedGeneration;
+    m_federatedPending = 0;
+    setIsLoading (false);
 }
 
 void SearchResultManager::cancel() {
     if (m_watcher.isRunning()) {
         m_isCancelled = true;
+        if (m_adoptedPrefetch) m_adoptedPrefetch->isCancelled = true;
     }
+    cancelPrefetch();
+    cancelFederated();
 }
 
 
@@ -88,6 +231,13 @@ QVariant SearchResultManager::data(const QModelIndex &index, int role) const {
     case CoverRole:
         return show.coverUrl;
         break;
+    case ProvidersRole: {
+        QStringList providers{show.provider->name()};
+        for (const auto &other : show.otherProviders) {
+            providers.append(other.provider->name());
+        }
+        return providers;
+    }
     default:
         break;
     }
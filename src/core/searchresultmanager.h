@@ -4,6 +4,7 @@
 
 #include "network/network.h"
 #include "showdata.h"
+#include "showindex.h"
 
 
 
@@ -14,11 +15,23 @@ class SearchResultManager : public QAbstractListModel
     Q_PROPERTY(float contentY READ getContentY WRITE setContentY NOTIFY contentYChanged)
 public:
     explicit SearchResultManager(QObject *parent = nullptr);
+    ~SearchResultManager() {
+        // Running federated tasks post back to this object, they have to finish before any member goes away
+        m_federatedPool.clear();
+        for (const auto &task : std::as_const(m_federatedTasks)) task->isCancelled = true;
+        m_federatedPool.waitForDone();
+        cancel();
+    }
     ShowData &at(int index) { return m_list[index]; }
+    int count() const { return m_list.count(); }
 
     void search(const QString& query,int page,int type, ShowProvider* provider);
     void latest(int page, int type, ShowProvider* provider);
     void popular(int page, int type, ShowProvider* provider);
+    // Sends the query to every provider at once, each provider's results are appended as soon as they arrive
+    // Returns false when the search was not started
+    bool searchAll(const QString& query, int page, int type, const QList<ShowProvider*> &providers);
+    void setFederatedDeadline(int msecs) { m_federatedDeadline = msecs; }
 
     bool isLoading() { return m_isLoading; }
 
@@ -31,9 +44,57 @@ public:
     Q_INVOKABLE void cancel();
 
     bool canLoadMore() {
-        return !(m_isLoading || m_watcher.isRunning() || !m_canFetchMore);
+        return !(m_isLoading || m_watcher.isRunning() || m_federatedPending > 0 || !m_canFetchMore);
     }
 private:
+    struct Query {
+        enum Kind { Search, Latest, Popular } kind;
+        QString text;
+        int page;
+        int type;
+        ShowProvider *provider;
+        bool operator==(const Query &other) const = default;
+        Query next() const { Query query = *this; query.page++; return query; }
+    };
+    static QFuture<QList<ShowData>> run(const Query &query, Client *client);
+    void load(const Query &query);
+    Query m_currentQuery{};
+
+    // The page after the one last shown, fetched in the background so scrolling appends without a wait.
+    // Only one page is buffered and it is discarded as soon as a different query is loaded
+    struct Prefetch {
+        Query query;
+        std::atomic<bool> isCancelled = false;
+        Client client{&isCancelled};
+        QFuture<QList<ShowData>> future;
+    };
+    std::shared_ptr<Prefetch> m_prefetch;
+    // The prefetch whose future the watcher took over, its client is the one cancel() has to stop
+    std::shared_ptr<Prefetch> m_adoptedPrefetch;
+    void startPrefetch(const Query &query);
+    void cancelPrefetch();
+
+    // One per provider in a federated search, the deadline cancels the provider's own client only
+    struct FederatedTask {
+        QString providerName;
+        std::atomic<bool> isCancelled = false;
+        Client client{&isCancelled};
+        bool isDone = false; // Main thread only, set by whichever of result or deadline comes first
+    };
+    QThreadPool m_federatedPool;
+    QList<std::shared_ptr<FederatedTask>> m_federatedTasks;
+    int m_federatedGeneration = 0;
+    int m_federatedPending = 0;
+    int m_federatedDeadline = 8000;
+    // Merges the same show coming from several providers into one row
+    ShowIndex m_showIndex;
+    QList<int> m_rowOfEntry;
+    // The only ways m_list changes. Replacing it clears the merge index with it, appending keeps the index valid
+    void resetRows(QList<ShowData> shows);
+    void appendRows(const QList<ShowData> &shows);
+    void finishFederatedTask(const std::shared_ptr<FederatedTask> &task, int generation, const QList<ShowData> &results);
+    void cancelFederated();
+
     QFutureWatcher<QList<ShowData>> m_watcher;
     std::atomic<bool> m_isCancelled = false;
     Client m_client{&m_isCancelled};
@@ -49,7 +110,8 @@ private:
 
     enum {
         TitleRole = Qt::UserRole,
-        CoverRole
+        CoverRole,
+        ProvidersRole
     };
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
@@ -57,6 +119,7 @@ private:
         QHash<int, QByteArray> names;
         names[TitleRole] = "title";
         names[CoverRole] = "cover";
+        names[ProvidersRole] = "providers";
         return names;
     };
 
@@ -17,6 +17,7 @@ void ShowData::copyFrom(const ShowData &other) {
     score = other.score;
     views = other.views;
     type = other.type;
+    otherProviders = other.otherProviders;
     m_listType = other.m_listType;
     m_playlist = other.m_playlist;
     if (m_playlist)
@@ -42,6 +43,17 @@ ShowData::~ShowData() {
     }
 }
 
+ShowData ShowData::withProvider(int providerIndex) const {
+    ShowData show(*this);
+    if (providerIndex <= 0 || providerIndex > otherProviders.size()) return show;
+    const auto other = otherProviders[providerIndex - 1];
+    show.otherProviders[providerIndex - 1] = {provider, link, title};
+    show.provider = other.provider;
+    show.link = other.link;
+    show.title = other.title;
+    return show;
+}
+
 void ShowData::setPlaylist(PlaylistItem *playlist) {
     if (m_playlist) m_playlist->disuse();
     if (playlist) playlist->use();
@@ -40,6 +40,15 @@ struct ShowData
     QString score;
     QString views;
     int type = 0;
+    // The same show found on other providers, filled when federated results are merged
+    struct ProviderLink {
+        ShowProvider *provider;
+        QString link;
+        QString title;
+    };
+    QList<ProviderLink> otherProviders;
+    // Copy of the show opened through otherProviders[providerIndex - 1], 0 is the show itself
+    ShowData withProvider(int providerIndex) const;
 
 public:
 
@@ -0,0 +1,166 @@
+#include "showindex.h"
+#include <QRegularExpression>
+#include <algorithm>
+
+namespace {
+quint64 mix(quint64 x) {
+    // splitmix64 finaliser, turns one shingle hash into independent looking per-slot hashes
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+bool isCjk(QChar c) {
+    auto script = c.script();
+    return script == QChar::Script_Han || script == QChar::Script_Hiragana
+           || script == QChar::Script_Katakana || script == QChar::Script_Hangul;
+}
+
+int chineseNumeral(const QString &text) {
+    static const QString digits = "零一二三四五六七八九";
+    if (text == "十") return 10;
+    int value = 0;
+    for (auto c : text) {
+        if (c == u'十') value = (value == 0 ? 1 : value) * 10;
+        else if (int digit = digits.indexOf(c); digit >= 0) value = value - value % 10 + digit;
+        else return 0;
+    }
+    return value;
+}
+}
+
+ShowIndex::Key ShowIndex::normalise(const QString &title) {
+    Key key;
+    QString text = title.normalized(QString::NormalizationForm_KC).toCaseFolded();
+
+    // Release tags such as (Sub), [HD] or 【中字】 say nothing about which show it is
+    static const QRegularExpression tagRegex(R"(\([^)]*\)|\[[^\]]*\]|【[^】]*】|（[^）]*）)");
+    text.remove(tagRegex);
+
+    static const QRegularExpression seasonRegex(
+        R"(\bseason\s*(\d+)\b|\b(\d+)(?:st|nd|rd|th)\s+season\b|\bs(\d+)\b|第\s*([0-9零一二三四五六七八九十]+)\s*[季部])");
+    auto match = seasonRegex.match(text);
+    if (match.hasMatch()) {
+        for (int i = 1; i <= 4 && key.season == 0; ++i) {
+            QString captured = match.captured(i);
+            if (captured.isEmpty()) continue;
+            bool ok = false;
+            key.season = captured.toInt(&ok);
+            if (!ok) key.season = chineseNumeral(captured);
+        }
+        text.remove(match.capturedStart(), match.capturedLength());
+    }
+    // Season 1 is usually left unmarked
+    if (key.season == 1) key.season = 0;
+
+    key.text.reserve(text.size());
+    bool pendingSpace = false;
+    for (auto c : std::as_const(text)) {
+        if (c.isLetterOrNumber()) {
+            if (pendingSpace && !key.text.isEmpty()) key.text += u' ';
+            key.text += c;
+            pendingSpace = false;
+        } else {
+            pendingSpace = true;
+        }
+    }
+    return key;
+}
+
+QList<quint64> ShowIndex::shingle(const QString &text) {
+    // CJK titles carry a word per one or two characters and have no spaces, bigrams suit them better
+    bool cjk = std::any_of(text.begin(), text.end(), isCjk);
+    int n = cjk ? 2 : 3;
+    QString padded = cjk ? QString(text).remove(u' ') : " " + text + " ";
+
+    QList<quint64> shingles;
+    if (padded.size() < n) {
+        if (!padded.isEmpty()) shingles.append(qHash(QStringView(padded), 0));
+        return shingles;
+    }
+    shingles.reserve(padded.size() - n + 1);
+    for (qsizetype i = 0; i + n <= padded.size(); ++i) {
+        shingles.append(qHash(QStringView(padded).sliced(i, n), 0));
+    }
+    std::sort(shingles.begin(), shingles.end());
+    shingles.erase(std::unique(shingles.begin(), shingles.end()), shingles.end());
+    return shingles;
+}
+
+ShowIndex::Signature ShowIndex::signature(const QList<quint64> &shingles) {
+    Signature sig;
+    sig.fill(~0ULL);
+    for (auto shingle : shingles) {
+        quint64 h = shingle;
+        for (int i = 0; i < kHashes; ++i) {
+            h = mix(h + i);
+            sig[i] = std::min(sig[i], h);
+        }
+    }
+    return sig;
+}
+
+quint64 ShowIndex::bandKey(const Signature &signature, int band) {
+    quint64 key = band;
+    for (int row = 0; row < kRows; ++row) {
+        key = mix(key ^ signature[band * kRows + row]);
+    }
+    return key;
+}
+
+bool ShowIndex::isSimilar(const QList<quint64> &a, const QList<quint64> &b) {
+    if (a.isEmpty() || b.isEmpty()) return false;
+    qsizetype common = 0;
+    for (qsizetype i = 0, j = 0; i < a.size() && j < b.size();) {
+        if (a[i] == b[j]) { common++; i++; j++; }
+        else if (a[i] < b[j]) i++;
+        else j++;
+    }
+    double jaccard = double(common) / double(a.size() + b.size() - common);
+    // Containment catches a title that only gains a subtitle on another site, short titles are
+    // excluded since a few shared shingles would match them to anything
+    qsizetype smaller = std::min(a.size(), b.size());
+    double containment = smaller >= 5 ? double(common) / double(smaller) : 0;
+    return jaccard >= 0.6 || containment >= 0.85;
+}
+
+int ShowIndex::insert(const QString &title, ShowProvider *provider, bool *isNew) {
+    Key key = normalise(title);
+    auto shingles = shingle(key.text);
+    auto sig = signature(shingles);
+
+    std::array<quint64, kBands> keys;
+    QList<int> candidates;
+    for (int band = 0; band < kBands; ++band) {
+        keys[band] = bandKey(sig, band);
+        auto it = m_buckets.constFind(keys[band]);
+        if (it != m_buckets.cend()) candidates += *it;
+    }
+    // Oldest entry first so merging does not depend on hash order
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (int id : std::as_const(candidates)) {
+        auto &entry = m_entries[id];
+        // Two results from the same provider are two different shows on that site
+        if (entry.season != key.season || entry.providers.contains(provider)) continue;
+        if (!isSimilar(entry.shingles, shingles)) continue;
+        entry.providers.append(provider);
+        if (isNew) *isNew = false;
+        return id;
+    }
+
+    int id = m_entries.size();
+    m_entries.append({key.season, std::move(shingles), {provider}});
+    for (int band = 0; band < kBands; ++band) {
+        m_buckets[keys[band]].append(id);
+    }
+    if (isNew) *isNew = true;
+    return id;
+}
+
+void ShowIndex::clear() {
+    m_entries.clear();
+    m_buckets.clear();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <array>
+
+class ShowProvider;
+
+// Incremental near-duplicate index over show titles from different providers. Titles are normalised
+// (case folded, tags, punctuation and season markers removed), shingled into character n-grams and
+// summarised by a MinHash signature. LSH buckets over the signature give the few candidates each new
+// title is compared against, so inserting stays cheap no matter how many results have streamed in
+class ShowIndex
+{
+public:
+    struct Key {
+        QString text;
+        int season = 0; // Different seasons of a show are never merged
+    };
+    static Key normalise(const QString &title);
+
+    // Returns the id of the existing entry the title belongs to, or a new id with isNew set
+    int insert(const QString &title, ShowProvider *provider, bool *isNew = nullptr);
+    void clear();
+    int size() const { return m_entries.size(); }
+
+private:
+    static constexpr int kHashes = 32;
+    static constexpr int kRows = 2; // 16 bands of 2 rows, candidate pairs start around 0.25 similarity
+    static constexpr int kBands = kHashes / kRows;
+    using Signature = std::array<quint64, kHashes>;
+
+    struct Entry {
+        int season;
+        QList<quint64> shingles; // Sorted and unique
+        QList<ShowProvider*> providers;
+    };
+    QList<Entry> m_entries;
+    QHash<quint64, QList<int>> m_buckets;
+
+    static QList<quint64> shingle(const QString &text);
+    static Signature signature(const QList<quint64> &shingles);
+    static quint64 bandKey(const Signature &signature, int band);
+    static bool isSimilar(const QList<quint64> &a, const QList<quint64> &b);
+};
@@ -12,15 +12,15 @@ void ShowManager::loadShow(const ShowData &show, const ShowData::LastWatchInfo &
         return;
     }
     auto tempShow = ShowData(show);
-    qInfo() << "Log (ShowManager)： Loading details for" << show.title
-            << "with" << show.provider->name()
-            << "using the link:" << show.link;
-    bool success = false;
-    try {
-        success = show.provider->loadDetails(&m_client, tempShow, true, lastWatchInfo.playlist == nullptr, false);
-    } catch(QException& ex) {
-        if (!m_isCancelled)
-            ErrorHandler::instance().show (ex.what(), show.provider->name() + " Error");
+    auto watchInfo = lastWatchInfo;
+    bool success = loadDetails(tempShow, watchInfo.playlist == nullptr);
+    // The same show found on other providers in a federated search is tried when this one fails
+    for (int i = 1; !success && !m_isCancelled && i <= show.otherProviders.size(); ++i) {
+        tempShow.setPlaylist(nullptr); // Drop whatever the failed attempt built
+        tempShow = show.withProvider(i);
+        // Watch progress belongs to the original link
+        watchInfo = {lastWatchInfo.listType, -1, 0, nullptr};
+        success = loadDetails(tempShow, true);
     }
 
     if (success && !m_isCancelled) {
@@ -30,14 +30,14 @@ void ShowManager::loadShow(const ShowData &show, const ShowData::LastWatchInfo &
         m_isCancelled = false;
         setIsLoading(false);
 
-        m_show.setListType(lastWatchInfo.listType);
-        if (lastWatchInfo.playlist)
-            m_show.setPlaylist(lastWatchInfo.playlist);
+        m_show.setListType(watchInfo.listType);
+        if (watchInfo.playlist)
+            m_show.setPlaylist(watchInfo.playlist);
         else {
-            qInfo() << "Log (ShowManager)： Setting last play info for" << show.title
-                    << lastWatchInfo.lastWatchedIndex << lastWatchInfo.timeStamp;
+            qInfo() << "Log (ShowManager)： Setting last play info for" << m_show.title
+                    << watchInfo.lastWatchedIndex << watchInfo.timeStamp;
             if (m_show.getPlaylist())
-                m_show.getPlaylist()->setLastPlayAt(lastWatchInfo.lastWatchedIndex, lastWatchInfo.timeStamp);
+                m_show.getPlaylist()->setLastPlayAt(watchInfo.lastWatchedIndex, watchInfo.timeStamp);
         }
         if (auto playlist = m_show.getPlaylist(); playlist) {
             m_episodeList.setPlaylist(playlist);
@@ -71,6 +71,19 @@ void ShowManager::setShow(const ShowData &show, const ShowData::LastWatchInfo &l
 
 
 
+bool ShowManager::loadDetails(ShowData &show, bool getPlaylist) {
+    qInfo() << "Log (ShowManager)： Loading details for" << show.title
+            << "with" << show.provider->name()
+            << "using the link:" << show.link;
+    try {
+        return show.provider->loadDetails(&m_client, show, true, getPlaylist, false);
+    } catch(QException& ex) {
+        if (!m_isCancelled)
+            ErrorHandler::instance().show (ex.what(), show.provider->name() + " Error");
+    }
+    return false;
+}
+
 void ShowManager::setListType(int listType) {
     m_show.setListType(listType);
     emit listTypeChanged();
@@ -58,6 +58,7 @@ private:
     }
 
     void loadShow(const ShowData &show, const ShowData::LastWatchInfo &lastWatchInfo);
+    bool loadDetails(ShowData &show, bool getPlaylist);
     std::atomic<bool> m_isCancelled = false;
     Client m_client { &m_isCancelled };
 
@@ -1,35 +1,66 @@
 #include "csoup.h"
+#include <cctype>
 
-CSoup::CSoup(const QString &htmlContent) {
+CSoup::CSoup(const QString &htmlContent) : CSoup(htmlContent.toUtf8()) {}
 
-    LIBXML_TEST_VERSION
-    QByteArray byteArray = htmlContent.toUtf8();
-    docPtr = std::shared_ptr<xmlDoc>(
-    htmlReadMemory(byteArray.constData(), byteArray.size(), nullptr, nullptr, HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING)
-    , xmlFreeDoc);
+CSoup::CSoup(std::shared_ptr<xmlDoc> document) {
+    if (document)
+        documentPtr = std::make_shared<Document>(std::move(document));
+}
 
+CSoup::CSoup(const QByteArray &byteArray) {
+    auto docPtr = readDocument(byteArray);
     if (docPtr == nullptr) {
         qDebug() << "Failed to parse HTML";
+        return;
     }
+    documentPtr = std::make_shared<Document>(std::move(docPtr));
+}
 
-    contextPtr = std::shared_ptr<xmlXPathContext>(xmlXPathNewContext(docPtr.get()), xmlXPathFreeContext);
-    if (contextPtr == nullptr) {
-        qDebug() << "Failed to create XPath context";
-        docPtr = nullptr;
-    }
+std::shared_ptr<xmlDoc> CSoup::readDocument(const QByteArray &htmlContent) {
+    LIBXML_TEST_VERSION
+    xmlDocPtr doc = htmlReadMemory(htmlContent.constData(), htmlContent.size(), nullptr, nullptr,
+                                   HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
+    if (!doc) return nullptr;
+    return std::shared_ptr<xmlDoc>(doc, xmlFreeDoc);
+}
 
+CSoup::Document::~Document() {
+    for (auto context : std::as_const(m_contexts)) {
+        xmlXPathFreeContext(context);
+    }
 }
 
+xmlXPathContextPtr CSoup::Document::context() {
+    Qt::HANDLE thread = QThread::currentThreadId();
+    QMutexLocker locker(&m_mutex);
+    auto it = m_contexts.find(thread);
+    if (it != m_contexts.end()) return *it;
+    xmlXPathContextPtr context = xmlXPathNewContext(docPtr.get());
+    if (context == nullptr) {
+        qDebug() << "Failed to create XPath context";
+        return nullptr;
+    }
+    m_contexts.insert(thread, context);
+    return context;
+}
 
+QVector<CSoup::NodeRef> CSoup::wrap(const QVector<xmlNodePtr> &nodes) const {
+    QVector<NodeRef> refs;
+    refs.reserve(nodes.size());
+    for (auto node : nodes) {
+        refs.emplaceBack(this, node);
+    }
+    return refs;
+}
 
-QVector<CSoup::Node> CSoup::select(std::shared_ptr<xmlDoc> docPtr, std::shared_ptr<xmlXPathContext> contextPtr, xmlNodePtr nodePtr, const QString &xpathExpr) {
-    QVector<Node> nodes;
-    contextPtr->node = nodePtr;
-    xmlXPathObjectPtr result = executeXPath(contextPtr, xpathExpr);
+QVector<xmlNodePtr> CSoup::selectNodes(xmlXPathContextPtr context, xmlNodePtr nodePtr, const QString &xpathExpr) {
+    QVector<xmlNodePtr> nodes;
+    if (!context) return nodes;
+    context->node = nodePtr;
+    xmlXPathObjectPtr result = executeXPath(context, xpathExpr.toUtf8());
     if (result && result->nodesetval) {
-        for (int i = 0; i < result->nodesetval->nodeNr; ++i) {
-            nodes.emplaceBack(docPtr, contextPtr, result->nodesetval->nodeTab[i]);
-        }
+        nodes.assign(result->nodesetval->nodeTab, result->nodesetval->nodeTab + result->nodesetval->nodeNr);
     }
     if (result) {
         xmlXPathFreeObject(result);
@@ -39,27 +70,332 @@ QVector<CSoup::Node> CSoup::select(std::shared_ptr<xmlDoc> docPtr, std::shared_p
     return nodes;
 }
 
-CSoup::Node CSoup::selectNth(std::shared_ptr<xmlDoc> docPtr, std::shared_ptr<xmlXPathContext> contextPtr, xmlNodePtr nodePtr, const QString &xpathExpr, int n, bool reversed) {
-    contextPtr->node = nodePtr;
-    xmlXPathObjectPtr result = executeXPath(contextPtr, xpathExpr);
-    if (result && result->nodesetval && result->nodesetval->nodeNr > 0 && n >= 0 && n < result->nodesetval->nodeNr) {
-        n = reversed ? result->nodesetval->nodeNr - 1 - n : n;
-        xmlNodePtr node = result->nodesetval->nodeTab[n];
-        xmlXPathFreeObject(result);
-        return Node(docPtr, contextPtr, node);
+xmlNodePtr CSoup::selectNthNode(xmlXPathContextPtr context, xmlNodePtr nodePtr, const QString &xpathExpr, int n, bool reversed) {
+    if (!context || n < 0) return nullptr;
+    context->node = nodePtr;
+    xmlNodePtr node = nullptr;
+    xmlXPathObjectPtr result = nullptr;
+    if (n == 0) {
+        // (expr)[1] and (expr)[last()] are evaluated with libxml2's first/last optimisations which stop
+        // at the first match, and only add two cache entries per expression
+        QByteArray positioned = '(' + xpathExpr.toUtf8() + (reversed ? ")[last()]" : ")[1]");
+        result = executeXPath(context, positioned);
+        if (result && result->nodesetval && result->nodesetval->nodeNr > 0)
+            node = result->nodesetval->nodeTab[0];
+    } else {
+        // Any other position indexes the node-set of the base expression, so walking a list by index
+        // reuses one compiled expression instead of caching one per position
+        result = executeXPath(context, xpathExpr.toUtf8());
+        if (result && result->nodesetval && n < result->nodesetval->nodeNr) {
+            const auto nodeSet = result->nodesetval;
+            node = nodeSet->nodeTab[reversed ? nodeSet->nodeNr - 1 - n : n];
+        }
     }
     if (result) {
         xmlXPathFreeObject(result);
     }
-    qDebug() << "No matching node found for" << xpathExpr;
-    return Node();
+    if (!node)
+        qDebug() << "No matching node found for" << xpathExpr;
+    return node;
+}
+
+QUtf8StringView CSoup::textViewOf(xmlNodePtr nodePtr) {
+    if (!nodePtr) return {};
+    if (nodePtr->type == XML_TEXT_NODE || nodePtr->type == XML_CDATA_SECTION_NODE)
+        return QUtf8StringView(reinterpret_cast<const char*>(nodePtr->content));
+    xmlNodePtr child = nodePtr->children;
+    if (nodePtr->type == XML_ELEMENT_NODE && child && !child->next
+        && (child->type == XML_TEXT_NODE || child->type == XML_CDATA_SECTION_NODE))
+        return QUtf8StringView(reinterpret_cast<const char*>(child->content));
+    return {};
+}
+
+QUtf8StringView CSoup::attrViewOf(xmlNodePtr nodePtr, QLatin1StringView attrName) {
+    if (!nodePtr || nodePtr->type != XML_ELEMENT_NODE) return {};
+    for (xmlAttrPtr prop = nodePtr->properties; prop; prop = prop->next) {
+        if (QLatin1StringView(reinterpret_cast<const char*>(prop->name)) != attrName) continue;
+        xmlNodePtr child = prop->children;
+        if (!child) return QUtf8StringView("");
+        if (child->type == XML_TEXT_NODE && !child->next)
+            return QUtf8StringView(reinterpret_cast<const char*>(child->content));
+        return {};
+    }
+    return {};
+}
+
+QString CSoup::textOf(xmlNodePtr nodePtr) {
+    if (!nodePtr) return "";
+    // A single text child is copied once into the QString, only mixed content goes through libxml2's buffer
+    if (auto view = textViewOf(nodePtr); !view.isNull()) return view.toString();
+    xmlChar *content = xmlNodeGetContent(nodePtr);
+    if (content) {
+        QString nodeContent = QString::fromUtf8(reinterpret_cast<const char*>(content));
+        xmlFree(content);
+        return nodeContent;
+    }
+    return "";
+}
+
+QString CSoup::attrOf(xmlNodePtr nodePtr, const QString &attrName) {
+    if (!nodePtr) return "";
+    QByteArray attrNameUtf8 = attrName.toUtf8();
+    xmlChar *attr = xmlGetProp(nodePtr, reinterpret_cast<const xmlChar*>(attrNameUtf8.constData()));
+    if (attr) {
+        QString attrValue = QString::fromUtf8(reinterpret_cast<const char*>(attr));
+        xmlFree(attr);
+        return attrValue;
+    }
+    return "";
+}
+
+QString CSoup::attrOf(xmlNodePtr nodePtr, QLatin1StringView attrName) {
+    if (!nodePtr) return "";
+    if (auto view = attrViewOf(nodePtr, attrName); !view.isNull()) return view.toString();
+    QByteArray attrNameLatin1(attrName.data(), attrName.size());
+    xmlChar *attr = xmlGetProp(nodePtr, reinterpret_cast<const xmlChar*>(attrNameLatin1.constData()));
+    if (attr) {
+        QString attrValue = QString::fromUtf8(reinterpret_cast<const char*>(attr));
+        xmlFree(attr);
+        return attrValue;
+    }
+    return "";
+}
+
+void CSoup::print(xmlDocPtr doc, xmlNodePtr nodePtr) {
+    if (!nodePtr) return;
+
+    xmlBufferPtr buffer = xmlBufferCreate();
+    if (buffer == nullptr) {
+        throw std::runtime_error("Failed to create xmlBuffer");
+    }
+    if (xmlNodeDump(buffer, doc, nodePtr, 0, 1) == -1) {
+        xmlBufferFree(buffer);
+        throw std::runtime_error("Failed to dump XML node");
+    }
+    QString nodeContent = QString::fromUtf8(reinterpret_cast<const char*>(buffer->content));
+    xmlBufferFree(buffer);
+    qDebug() << nodeContent;
+}
+
+xmlXPathCompExprPtr CSoup::compile(const QByteArray &xpathExpr, bool *isOwned) {
+    *isOwned = false;
+    {
+        QReadLocker locker(&s_xpathCacheLock);
+        if (auto compiled = s_xpathCache.value(xpathExpr)) {
+            s_xpathCacheHits++;
+            return compiled;
+        }
+    }
+    s_xpathCacheMisses++;
+    xmlXPathCompExprPtr compiled = xmlXPathCompile(reinterpret_cast<const xmlChar*>(xpathExpr.constData()));
+    if (!compiled) return nullptr;
+
+    QWriteLocker locker(&s_xpathCacheLock);
+    // Another thread may have compiled the same expression in the meantime
+    if (auto existing = s_xpathCache.value(xpathExpr)) {
+        xmlXPathFreeCompExpr(compiled);
+        return existing;
+    }
+    if (s_xpathCache.size() >= maxCachedXPaths) {
+        // Expressions built from page data would grow the cache forever, other threads may still be
+        // evaluating the cached ones so they cannot be evicted, the caller evaluates this one and frees it
+        *isOwned = true;
+        return compiled;
+    }
+    s_xpathCache.insert(xpathExpr, compiled);
+    return compiled;
+}
+
+void CSoup::cleanupXPathCache() {
+    QWriteLocker locker(&s_xpathCacheLock);
+    qDebug() << "Log (CSoup): XPath cache hits" << s_xpathCacheHits << "misses" << s_xpathCacheMisses;
+    for (auto expr : std::as_const(s_xpathCache)) {
+        xmlXPathFreeCompExpr(expr);
+    }
+    s_xpathCache.clear();
 }
-xmlXPathObjectPtr CSoup::executeXPath(std::shared_ptr<xmlXPathContext> context, const QString &xpathExpr) {
+
+xmlXPathObjectPtr CSoup::executeXPath(xmlXPathContextPtr context, const QByteArray &xpathExprUtf8) {
     if (!context) return nullptr;
-    QByteArray xpathExprUtf8 = xpathExpr.toUtf8();
-    xmlXPathObjectPtr result = xmlXPathEvalExpression(reinterpret_cast<const xmlChar*>(xpathExprUtf8.constData()), context.get());
+    bool isOwned = false;
+    xmlXPathCompExprPtr compiled = compile(xpathExprUtf8, &isOwned);
+    xmlXPathObjectPtr result = compiled ? xmlXPathCompiledEval(compiled, context) : nullptr;
+    if (isOwned)
+        xmlXPathFreeCompExpr(compiled);
     if (result == nullptr) {
         qDebug() << "Failed to evaluate XPath expression" << xpathExprUtf8;
     }
     return result;
 }
+
+const QStringList &CSoup::Table::column(const QString &name) const {
+    static const QStringList empty;
+    int index = names.indexOf(name);
+    return index < 0 ? empty : columns[index];
+}
+
+std::optional<QList<CSoup::PathStep>> CSoup::parsePath(const QString &path) {
+    QByteArray expr = path.trimmed().toUtf8();
+    if (!expr.startsWith('.')) return std::nullopt;
+    QList<PathStep> steps;
+    qsizetype pos = 1;
+    auto isNameChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_'; };
+    auto readName = [&]() {
+        qsizetype start = pos;
+        while (pos < expr.size() && isNameChar(expr[pos])) pos++;
+        return expr.mid(start, pos - start);
+    };
+
+    while (pos < expr.size()) {
+        PathStep step;
+        if (expr.mid(pos, 2) == "//") {
+            step.descendant = true;
+            pos += 2;
+        } else if (expr[pos] == '/') {
+            pos += 1;
+        } else {
+            return std::nullopt;
+        }
+
+        if (pos < expr.size() && expr[pos] == '*') {
+            step.name = "*";
+            pos++;
+        } else {
+            step.name = readName();
+            if (step.name.isEmpty()) return std::nullopt;
+        }
+
+        while (pos < expr.size() && expr[pos] == '[') {
+            pos++;
+            if (pos >= expr.size() || expr[pos] != '@') return std::nullopt;
+            pos++;
+            QByteArray attrName = readName();
+            if (attrName.isEmpty() || pos >= expr.size()) return std::nullopt;
+            if (expr[pos] == ']') {
+                step.predicates.append({attrName, std::nullopt});
+            } else {
+                if (expr[pos] != '=' || pos + 1 >= expr.size()) return std::nullopt;
+                char quote = expr[pos + 1];
+                if (quote != '\'' && quote != '"') return std::nullopt;
+                qsizetype end = expr.indexOf(quote, pos + 2);
+                if (end < 0) return std::nullopt;
+                step.predicates.append({attrName, expr.mid(pos + 2, end - pos - 2)});
+                pos = end + 1;
+                if (pos >= expr.size() || expr[pos] != ']') return std::nullopt;
+            }
+            pos++;
+        }
+        steps.append(step);
+    }
+    return steps;
+}
+
+bool CSoup::matchStep(const PathStep &step, xmlNodePtr node) {
+    if (node->type != XML_ELEMENT_NODE) return false;
+    if (step.name != "*" && !xmlStrEqual(node->name, reinterpret_cast<const xmlChar*>(step.name.constData())))
+        return false;
+    for (const auto &[name, value] : step.predicates) {
+        xmlAttrPtr prop = node->properties;
+        while (prop && !xmlStrEqual(prop->name, reinterpret_cast<const xmlChar*>(name.constData())))
+            prop = prop->next;
+        if (!prop) return false;
+        if (!value) continue;
+        xmlNodePtr child = prop->children;
+        if (!child) {
+            if (!value->isEmpty()) return false;
+        } else if (child->type == XML_TEXT_NODE && !child->next) {
+            // The common single text child is compared in place without copying the value
+            if (!xmlStrEqual(child->content, reinterpret_cast<const xmlChar*>(value->constData()))) return false;
+        } else {
+            xmlChar *content = xmlNodeListGetString(node->doc, child, 1);
+            bool equal = xmlStrEqual(content, reinterpret_cast<const xmlChar*>(value->constData()));
+            xmlFree(content);
+            if (!equal) return false;
+        }
+    }
+    return true;
+}
+
+bool CSoup::matchSteps(const QList<PathStep> &steps, int index, xmlNodePtr node, xmlNodePtr root) {
+    const PathStep &step = steps[index];
+    if (!matchStep(step, node)) return false;
+    xmlNodePtr parent = node->parent;
+    if (index == 0) {
+        // Only nodes inside the item's subtree are ever tested, so any depth satisfies a leading //
+        return step.descendant || parent == root;
+    }
+    if (!step.descendant) {
+        return parent && parent != root && matchSteps(steps, index - 1, parent, root);
+    }
+    for (xmlNodePtr ancestor = parent; ancestor && ancestor != root; ancestor = ancestor->parent) {
+        if (matchSteps(steps, index - 1, ancestor, root)) return true;
+    }
+    return false;
+}
+
+CSoup::Table CSoup::extract(const Schema &schema) const {
+    Table table;
+    const auto &fields = schema.fields;
+    QList<std::optional<QList<PathStep>>> paths;
+    QList<QByteArray> attrNames;
+    for (const auto &field : fields) {
+        table.names.append(field.name);
+        attrNames.append(field.attr.toLatin1());
+        table.columns.append(QStringList());
+        paths.append(parsePath(field.path));
+        if (!paths.last())
+            qDebug() << "Log (CSoup): Field" << field.name << "falls back to XPath for" << field.path;
+    }
+    if (!documentPtr) return table;
+
+    xmlXPathContextPtr context = documentPtr->context();
+    const auto items = selectNodes(context, nullptr, schema.itemSelector);
+    table.rowCount = items.size();
+    for (auto &column : table.columns) {
+        column.reserve(table.rowCount);
+    }
+
+    QVector<xmlNodePtr> matched(fields.size());
+    for (auto item : items) {
+        int remaining = 0;
+        for (int i = 0; i < fields.size(); ++i) {
+            matched[i] = nullptr;
+            if (!paths[i]) {
+                matched[i] = selectNthNode(context, item, fields[i].path, 0);
+            } else if (paths[i]->isEmpty()) {
+                matched[i] = item;
+            } else {
+                remaining++;
+            }
+        }
+
+        // Preorder walk visits nodes in document order, so the first match of a field is what selectFirst would return
+        xmlNodePtr node = item->children;
+        while (node && remaining > 0) {
+            if (node->type == XML_ELEMENT_NODE) {
+                for (int i = 0; i < fields.size(); ++i) {
+                    if (matched[i] || !paths[i] || paths[i]->isEmpty()) continue;
+                    if (matchSteps(*paths[i], paths[i]->size() - 1, node, item)) {
+                        matched[i] = node;
+                        remaining--;
+                    }
+                }
+                if (node->children) {
+                    node = node->children;
+                    continue;
+                }
+            }
+            while (node != item && !node->next) node = node->parent;
+            if (node == item) break;
+            node = node->next;
+        }
+
+        for (int i = 0; i < fields.size(); ++i) {
+            const auto &field = fields[i];
+            QString value = field.attr.isEmpty() ? textOf(matched[i]) : attrOf(matched[i], QLatin1StringView(attrNames[i]));
+            if (field.transform) value = field.transform(value);
+            table.columns[i].append(value);
+        }
+    }
+    return table;
+}
@@ -5,15 +5,36 @@
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
 #include <QString>
+#include <QUtf8StringView>
 #include <QVector>
 #include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QThread>
+#include <functional>
+#include <optional>
 
 class CSoup {
     CSoup(const QString &htmlContent);
+    CSoup(const QByteArray &htmlContent);
+    CSoup(std::shared_ptr<xmlDoc> document);
 
 
-    std::shared_ptr<xmlDoc> docPtr = nullptr;
-    std::shared_ptr<xmlXPathContext> contextPtr = nullptr;
+    // The parsed tree is only read after parsing, but an XPath context carries the current node,
+    // so every thread querying the document gets a context of its own
+    struct Document {
+        explicit Document(std::shared_ptr<xmlDoc> doc) : docPtr(std::move(doc)) {}
+        ~Document();
+        xmlXPathContextPtr context();
+
+        std::shared_ptr<xmlDoc> docPtr;
+    private:
+        QMutex m_mutex;
+        QHash<Qt::HANDLE, xmlXPathContextPtr> m_contexts;
+    };
+
+    std::shared_ptr<Document> documentPtr = nullptr;
     // xmlNodePtr nodePtr = nullptr;
 
 
@@ -21,6 +42,16 @@ public:
     static CSoup parse(const QString &htmlContent) {
         return CSoup(htmlContent);
     }
+    // Parses UTF-8 bytes as they came off the wire, without a round trip through QString
+    static CSoup parse(const QByteArray &htmlContent) {
+        return CSoup(htmlContent);
+    }
+    // Wraps a document that was already parsed, e.g. on a worker thread by Client::getHtmlAsync
+    static CSoup fromDocument(std::shared_ptr<xmlDoc> document) {
+        return CSoup(std::move(document));
+    }
+    // Parses without wrapping, null if libxml2 gave up
+    static std::shared_ptr<xmlDoc> readDocument(const QByteArray &htmlContent);
 
     // Deleting copy constructor and copy assignment operator
     CSoup(const CSoup&) = delete;
@@ -32,8 +63,8 @@ public:
 
     struct Node {
 
-        Node(std::shared_ptr<xmlDoc> docPtr = nullptr, std::shared_ptr<xmlXPathContext> contextPtr = nullptr, xmlNodePtr nodePtr = nullptr)
-            : m_nodePtr(nodePtr), m_docPtr(docPtr), m_contextPtr(contextPtr) {}
+        Node(std::shared_ptr<Document> documentPtr = nullptr, xmlNodePtr nodePtr = nullptr)
+            : m_nodePtr(nodePtr), m_documentPtr(documentPtr) {}
 
         // Default copy constructor and assignment operator
         Node(const Node&) = default;
@@ -49,60 +80,118 @@ public:
 
         Node selectNth(const QString &xpathExpr, int n, bool reversed = false) const {
             if (!m_nodePtr) return Node();
-            return CSoup::selectNth(m_docPtr, m_contextPtr, m_nodePtr, xpathExpr, n, reversed);
+            xmlNodePtr node = CSoup::selectNthNode(m_documentPtr->context(), m_nodePtr, xpathExpr, n, reversed);
+            return node ? Node(m_documentPtr, node) : Node();
         }
 
         QString text() const {
-            if (!m_nodePtr) return "";
-            xmlChar *content = xmlNodeGetContent(m_nodePtr);
-            if (content) {
-                QString nodeContent = QString::fromUtf8(reinterpret_cast<const char*>(content));
-                xmlFree(content);
-                return nodeContent;
-            }
-            return "";
+            return CSoup::textOf(m_nodePtr);
         }
 
         QString attr(const QString &attrName) const {
-            if (!m_nodePtr) return "";
-            QByteArray attrNameUtf8 = attrName.toUtf8();
-            xmlChar *attr = xmlGetProp(m_nodePtr, reinterpret_cast<const xmlChar*>(attrNameUtf8.constData()));
-            if (attr) {
-                QString attrValue = QString::fromUtf8(reinterpret_cast<const char*>(attr));
-                xmlFree(attr);
-                return attrValue;
-            }
-            return "";
+            return CSoup::attrOf(m_nodePtr, attrName);
+        }
+        // Literal names are matched as Latin-1 in place, without a QString round trip
+        QString attr(QLatin1StringView attrName) const {
+            return CSoup::attrOf(m_nodePtr, attrName);
+        }
+        QString attr(const char *attrName) const {
+            return CSoup::attrOf(m_nodePtr, QLatin1StringView(attrName));
+        }
+
+        // Views straight into libxml2's storage, valid as long as the document. Null when the value
+        // is spread over several child nodes, in which case text()/attr() still return it
+        QUtf8StringView textView() const {
+            return CSoup::textViewOf(m_nodePtr);
+        }
+        QUtf8StringView attrView(QLatin1StringView attrName) const {
+            return CSoup::attrViewOf(m_nodePtr, attrName);
         }
 
         QVector<Node> select(const QString &xpathExpr) const {
             if (!m_nodePtr) return {};
-            return CSoup::select(m_docPtr, m_contextPtr, m_nodePtr, xpathExpr);
+            QVector<Node> nodes;
+            for (auto node : CSoup::selectNodes(m_documentPtr->context(), m_nodePtr, xpathExpr)) {
+                nodes.emplaceBack(m_documentPtr, node);
+            }
+            return nodes;
         }
 
         void print() const {
-            if (!m_nodePtr) return;
+            if (m_documentPtr) CSoup::print(m_documentPtr->docPtr.get(), m_nodePtr);
+        }
 
-            xmlBufferPtr buffer = xmlBufferCreate();
-            if (buffer == nullptr) {
-                throw std::runtime_error("Failed to create xmlBuffer");
-            }
-            if (xmlNodeDump(buffer, m_docPtr.get(), m_nodePtr, 0, 1) == -1) {
-                xmlBufferFree(buffer);
-                throw std::runtime_error("Failed to dump XML node");
-            }
-            QString nodeContent = QString::fromUtf8(reinterpret_cast<const char*>(buffer->content));
-            xmlBufferFree(buffer);
-            qDebug() << nodeContent;
+        explicit operator bool() const {
+            return  m_nodePtr != nullptr ||  m_documentPtr != nullptr;
+        }
+
+    private:
+        std::shared_ptr<Document> m_documentPtr = nullptr;
+        xmlNodePtr m_nodePtr = nullptr;
+    };
+
+    // Non-owning handle for iterating results: a raw node plus the soup it came from, no reference counting.
+    // Only valid while that CSoup is alive, call toNode() for the rare node that has to outlive it
+    struct NodeRef {
+        NodeRef(const CSoup *soup = nullptr, xmlNodePtr nodePtr = nullptr) : m_soup(soup), m_nodePtr(nodePtr) {}
+
+        inline NodeRef selectFirst(const QString &xpathExpr) const {
+            return selectNth(xpathExpr, 0);
+        }
+
+        inline NodeRef selectLast(const QString &xpathExpr) const {
+            return selectNth(xpathExpr, 0, true);
+        }
+
+        NodeRef selectNth(const QString &xpathExpr, int n, bool reversed = false) const {
+            if (!m_nodePtr) return NodeRef();
+            return NodeRef(m_soup, CSoup::selectNthNode(m_soup->documentPtr->context(), m_nodePtr, xpathExpr, n, reversed));
+        }
+
+        QVector<NodeRef> select(const QString &xpathExpr) const {
+            if (!m_nodePtr) return {};
+            return m_soup->wrap(CSoup::selectNodes(m_soup->documentPtr->context(), m_nodePtr, xpathExpr));
+        }
+
+        QString text() const {
+            return CSoup::textOf(m_nodePtr);
+        }
+
+        QString attr(const QString &attrName) const {
+            return CSoup::attrOf(m_nodePtr, attrName);
+        }
+        // Literal names are matched as Latin-1 in place, without a QString round trip
+        QString attr(QLatin1StringView attrName) const {
+            return CSoup::attrOf(m_nodePtr, attrName);
+        }
+        QString attr(const char *attrName) const {
+            return CSoup::attrOf(m_nodePtr, QLatin1StringView(attrName));
+        }
+
+        // Views straight into libxml2's storage, valid as long as the document. Null when the value
+        // is spread over several child nodes, in which case text()/attr() still return it
+        QUtf8StringView textView() const {
+            return CSoup::textViewOf(m_nodePtr);
+        }
+        QUtf8StringView attrView(QLatin1StringView attrName) const {
+            return CSoup::attrViewOf(m_nodePtr, attrName);
+        }
+
+        Node toNode() const {
+            if (!m_nodePtr) return Node();
+            return Node(m_soup->documentPtr, m_nodePtr);
+        }
+
+        void print() const {
+            if (m_soup) CSoup::print(m_soup->documentPtr->docPtr.get(), m_nodePtr);
         }
 
         explicit operator bool() const {
-            return  m_nodePtr != nullptr ||  m_docPtr != nullptr ||  m_contextPtr != nullptr;
+            return m_nodePtr != nullptr;
         }
 
     private:
-        std::shared_ptr<xmlDoc> m_docPtr = nullptr;
-        std::shared_ptr<xmlXPathContext> m_contextPtr = nullptr;
+        const CSoup *m_soup = nullptr;
         xmlNodePtr m_nodePtr = nullptr;
     };
 
@@ -115,24 +204,107 @@ public:
     }
 
     Node selectNth(const QString &xpathExpr, int n, bool reversed=false) const {
-        if (!docPtr) return Node();
-        return CSoup::selectNth(docPtr, contextPtr, nullptr, xpathExpr, 0, reversed);
+        if (!documentPtr) return Node();
+        xmlNodePtr node = selectNthNode(documentPtr->context(), nullptr, xpathExpr, n, reversed);
+        return node ? Node(documentPtr, node) : Node();
     }
 
     QVector<Node> select(const QString &xpathExpr) const {
-        if (!docPtr) return {};
-        return CSoup::select(docPtr, contextPtr, nullptr, xpathExpr);
+        if (!documentPtr) return {};
+        QVector<Node> nodes;
+        for (auto node : selectNodes(documentPtr->context(), nullptr, xpathExpr)) {
+            nodes.emplaceBack(documentPtr, node);
+        }
+        return nodes;
     }
 
-    explicit operator bool() const {return docPtr && contextPtr;}
+    // Handle based variants of the above, the results borrow this soup and must not outlive it
+    inline NodeRef selectFirstRef(const QString &xpathExpr) const {
+        return selectNthRef(xpathExpr, 0);
+    }
+    inline NodeRef selectLastRef(const QString &xpathExpr) const {
+        return selectNthRef(xpathExpr, 0, true);
+    }
 
+    NodeRef selectNthRef(const QString &xpathExpr, int n, bool reversed=false) const {
+        if (!documentPtr) return NodeRef();
+        return NodeRef(this, selectNthNode(documentPtr->context(), nullptr, xpathExpr, n, reversed));
+    }
+
+    QVector<NodeRef> selectRefs(const QString &xpathExpr) const {
+        if (!documentPtr) return {};
+        return wrap(selectNodes(documentPtr->context(), nullptr, xpathExpr));
+    }
+
+    // Every query method may be called from several threads at once on the same soup
+    explicit operator bool() const {return documentPtr != nullptr;}
+
+    // Frees the compiled XPath expressions, must be called before xmlCleanupParser
+    static void cleanupXPathCache();
+    static quint64 xpathCacheHits() { return s_xpathCacheHits; }
+    static quint64 xpathCacheMisses() { return s_xpathCacheMisses; }
+
+    // Declarative list extraction: one XPath query finds the items, then all fields of an item are
+    // filled from a single walk over its subtree instead of one XPath query per field
+    struct Field {
+        QString name;
+        // "." for the item itself, otherwise a relative path of name tests and [@attr='value'] or [@attr]
+        // predicates joined by / and //, e.g. ".//p[@class='name']/a". Anything else falls back to XPath
+        QString path;
+        QString attr = {};  // Empty reads the text content
+        std::function<QString(const QString &)> transform = nullptr;
+    };
+    struct Schema {
+        QString itemSelector;
+        QList<Field> fields;
+    };
+    // Columnar result, one column per field in schema order and one row per item
+    struct Table {
+        QStringList names;
+        QList<QStringList> columns;
+        int rowCount = 0;
+
+        const QStringList &column(const QString &name) const;
+        QString value(int row, const QString &name) const { return column(name).value(row); }
+    };
+    Table extract(const Schema &schema) const;
 
-private:
-    static QVector<Node> select(std::shared_ptr<xmlDoc> docPtr, std::shared_ptr<xmlXPathContext> contextPtr, xmlNodePtr nodePtr, const QString &xpathExpr);
 
-    static Node selectNth(std::shared_ptr<xmlDoc> docPtr, std::shared_ptr<xmlXPathContext> contextPtr, xmlNodePtr nodePtr,  const QString &xpathExpr, int n, bool reversed = false);
+private:
+    QVector<NodeRef> wrap(const QVector<xmlNodePtr> &nodes) const;
 
-    static xmlXPathObjectPtr executeXPath(std::shared_ptr<xmlXPathContext> context, const QString &xpathExpr);
+    struct PathStep {
+        bool descendant = false;  // Preceded by // instead of /
+        QByteArray name;  // "*" matches any element
+        QList<QPair<QByteArray, std::optional<QByteArray>>> predicates;  // Attribute and the value it must equal, if any
+    };
+    static std::optional<QList<PathStep>> parsePath(const QString &path);
+    // Matches the steps right to left from the node up to the item root
+    static bool matchSteps(const QList<PathStep> &steps, int index, xmlNodePtr node, xmlNodePtr root);
+    static bool matchStep(const PathStep &step, xmlNodePtr node);
+
+    static QVector<xmlNodePtr> selectNodes(xmlXPathContextPtr context, xmlNodePtr nodePtr, const QString &xpathExpr);
+
+    static xmlNodePtr selectNthNode(xmlXPathContextPtr context, xmlNodePtr nodePtr, const QString &xpathExpr, int n, bool reversed = false);
+
+    static QString textOf(xmlNodePtr nodePtr);
+    static QString attrOf(xmlNodePtr nodePtr, const QString &attrName);
+    static QString attrOf(xmlNodePtr nodePtr, QLatin1StringView attrName);
+    static QUtf8StringView textViewOf(xmlNodePtr nodePtr);
+    static QUtf8StringView attrViewOf(xmlNodePtr nodePtr, QLatin1StringView attrName);
+    static void print(xmlDocPtr doc, xmlNodePtr nodePtr);
+
+    static xmlXPathObjectPtr executeXPath(xmlXPathContextPtr context, const QByteArray &xpathExpr);
+
+    // Provider loops evaluate the same few expressions once per item, so each one is compiled only once.
+    // Returns nullptr for invalid expressions. Once the cache is full the expression is compiled uncached
+    // and isOwned is set, the caller frees it after evaluating
+    static xmlXPathCompExprPtr compile(const QByteArray &xpathExpr, bool *isOwned);
+    inline static QHash<QByteArray, xmlXPathCompExprPtr> s_xpathCache;
+    inline static QReadWriteLock s_xpathCacheLock;
+    inline static std::atomic<quint64> s_xpathCacheHits = 0;
+    inline static std::atomic<quint64> s_xpathCacheMisses = 0;
+    inline static constexpr int maxCachedXPaths = 1024;
 };
 
 
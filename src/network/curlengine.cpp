@@ -0,0 +1,504 @@
+#include "curlengine.h"
+#include "myexception.h"
+#include <algorithm>
+#include <cmath>
+#include <QRandomGenerator>
+
+CurlEngine *CurlEngine::instance() {
+    if (!s_instance) {
+        s_instance = new CurlEngine;
+    }
+    return s_instance;
+}
+
+void CurlEngine::shutdown() {
+    CurlEngine *engine = nullptr;
+    {
+        QMutexLocker locker(&s_instanceMutex);
+        s_isShutDown = true;
+        engine = s_instance;
+        s_instance = nullptr;
+    }
+    // Joined outside the lock, continuations of the failed transfers may still try to submit
+    delete engine;
+}
+
+QFuture<Client::Response> CurlEngine::submit(const Client::Request &request) {
+    QMutexLocker locker(&s_instanceMutex);
+    if (s_isShutDown) {
+        qDebug() << "Log (CurlEngine): Dropped request after shutdown" << request.url;
+        QPromise<Client::Response> promise;
+        promise.start();
+        promise.setException(MyException("Network engine shut down"));
+        promise.finish();
+        return promise.future();
+    }
+    return instance()->enqueue(request);
+}
+
+void CurlEngine::setHostLimits(const QByteArray &host, const Client::HostLimits &limits) {
+    QMutexLocker locker(&s_instanceMutex);
+    if (s_isShutDown) return;
+    instance()->updateHostLimits(host, limits);
+}
+
+CurlEngine::CurlEngine() {
+    m_multi = curl_multi_init();
+    m_clock.start();
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("CurlEngine");
+    m_thread->start();
+}
+
+CurlEngine::~CurlEngine() {
+    m_isStopping = true;
+    curl_multi_wakeup(m_multi);
+    m_thread->wait();
+    delete m_thread;
+    curl_multi_cleanup(m_multi);
+}
+
+QFuture<Client::Response> CurlEngine::enqueue(const Client::Request &request) {
+    Waiter waiter;
+    waiter.isCancelled = request.isCancelled;
+    waiter.promise.start();
+    auto future = waiter.promise.future();
+    // Only GETs are coalesced, anything else may have side effects on the server
+    QByteArray key = request.type == Client::GET ? keyOf(request) : QByteArray();
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto transfer = m_inflight.value(key)) {
+            qDebug() << "Log (CurlEngine): Joined in-flight request" << request.url;
+            transfer->waiters.push_back(std::move(waiter));
+            return future;
+        }
+        auto transfer = new Transfer;
+        transfer->engine = this;
+        transfer->request = request;
+        // Cancellation is tracked per waiter, the shared transfer only stops when all of them gave up
+        transfer->request.isCancelled = nullptr;
+        transfer->key = key;
+        transfer->host = Client::hostOf(request.url);
+        transfer->waiters.push_back(std::move(waiter));
+        if (!key.isEmpty())
+            m_inflight.insert(key, transfer);
+        m_pending.append(transfer);
+    }
+    curl_multi_wakeup(m_multi);
+    return future;
+}
+
+QByteArray CurlEngine::keyOf(const Client::Request &request) {
+    QByteArray key = QByteArray::number(request.type) + ' ' + QByteArray::fromStdString(request.url);
+    // A joined caller inherits the transfer's timeout, retries and hedging, so only identical policies share one
+    const auto &retry = request.retry;
+    key += '\n' + QByteArray::number(request.timeout) + ' ' + QByteArray::number(retry.maxAttempts)
+           + ' ' + QByteArray::number(retry.baseDelay) + ' ' + QByteArray::number(retry.maxDelay)
+           + ' ' + QByteArray::number(retry.hedge);
+    for (auto it = request.headers.constBegin(); it != request.headers.constEnd(); ++it) {
+        key += '\n' + it.key().toUtf8() + ": " + it.value().toUtf8();
+    }
+    return key;
+}
+
+std::vector<CurlEngine::Waiter> CurlEngine::detach(Transfer *transfer) {
+    QMutexLocker locker(&m_mutex);
+    if (!transfer->key.isEmpty() && m_inflight.value(transfer->key) == transfer)
+        m_inflight.remove(transfer->key);
+    return std::move(transfer->waiters);
+}
+
+bool CurlEngine::dropCancelledWaiters(Transfer *transfer) {
+    QMutexLocker locker(&m_mutex);
+    auto &waiters = transfer->waiters;
+    for (auto it = waiters.begin(); it != waiters.end();) {
+        if (it->isCancelled && *it->isCancelled) {
+            it->promise.setException(MyException("Request canceled!"));
+            it->promise.finish();
+            it = waiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!waiters.empty()) return true;
+    if (!transfer->key.isEmpty() && m_inflight.value(transfer->key) == transfer)
+        m_inflight.remove(transfer->key);
+    return false;
+}
+
+void CurlEngine::updateHostLimits(const QByteArray &host, const Client::HostLimits &limits) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_limits[host] = limits;
+        m_limitsChanged = true;
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+CurlEngine::HostState &CurlEngine::hostState(const QByteArray &host) {
+    auto it = m_hosts.find(host);
+    if (it == m_hosts.end()) {
+        it = m_hosts.insert(host, HostState());
+        QMutexLocker locker(&m_mutex);
+        it->limits = m_limits.value(host);
+    }
+    return *it;
+}
+
+qint64 CurlEngine::dispatch() {
+    qint64 now = m_clock.elapsed();
+    qint64 nextToken = -1;
+    for (auto it = m_hosts.begin(); it != m_hosts.end(); ++it) {
+        HostState &state = *it;
+        if (state.queue.isEmpty()) continue;
+        const auto &limits = state.limits;
+        refill(state, now);
+
+        while (!state.queue.isEmpty() && state.running < std::max(1, limits.maxConnections)) {
+            if (limits.requestsPerSecond > 0 && state.tokens < 1.0) {
+                qint64 wait = static_cast<qint64>(std::ceil((1.0 - state.tokens) * 1000.0 / limits.requestsPerSecond));
+                if (nextToken < 0 || wait < nextToken) nextToken = wait;
+                break;
+            }
+            if (start(state.queue.takeFirst()) && limits.requestsPerSecond > 0) {
+                state.tokens -= 1.0;
+            }
+        }
+
+        // Waiters that gave up while queued should not have to wait for a free slot to hear about it
+        for (auto queued = state.queue.begin(); queued != state.queue.end();) {
+            if (!dropCancelledWaiters(*queued)) {
+                fail(*queued, "Request canceled!");
+                queued = state.queue.erase(queued);
+            } else {
+                ++queued;
+            }
+        }
+    }
+    return nextToken;
+}
+
+qint64 CurlEngine::handleTimers() {
+    qint64 now = m_clock.elapsed();
+    qint64 next = -1;
+    auto wakeIn = [&next](qint64 wait) {
+        if (next < 0 || wait < next) next = wait;
+    };
+
+    for (auto it = m_delayed.begin(); it != m_delayed.end();) {
+        if (it->first <= now) {
+            hostState(it->second->host).queue.append(it->second);
+            it = m_delayed.erase(it);
+        } else {
+            wakeIn(it->first - now);
+            ++it;
+        }
+    }
+
+    QList<Transfer*> hedges;
+    for (auto attempt : std::as_const(m_running)) {
+        auto transfer = attempt->transfer;
+        if (transfer->hedgeAt < 0) continue;
+        if (transfer->hedgeAt <= now) {
+            transfer->hedgeAt = -1;
+            hedges.append(transfer);
+        } else {
+            wakeIn(transfer->hedgeAt - now);
+        }
+    }
+    // Hedges skip the host queue, waiting behind the transfers that are stalling would defeat them,
+    // but they still count against the host's limits and are dropped when it has no room for them
+    for (auto transfer : std::as_const(hedges)) {
+        auto &state = hostState(transfer->host);
+        const auto &limits = state.limits;
+        refill(state, now);
+        if (state.running >= std::max(1, limits.maxConnections)
+            || (limits.requestsPerSecond > 0 && state.tokens < 1.0)) {
+            qDebug() << "Log (CurlEngine): Host at its limit, not hedging" << transfer->request.url;
+            continue;
+        }
+        qDebug() << "Log (CurlEngine): Hedging slow request" << transfer->request.url;
+        if (startAttempt(transfer) && limits.requestsPerSecond > 0)
+            state.tokens -= 1.0;
+    }
+    return next;
+}
+
+void CurlEngine::refill(HostState &state, qint64 now) {
+    const auto &limits = state.limits;
+    if (limits.requestsPerSecond <= 0) return;
+    // The bucket holds at most one second worth of requests so an idle host cannot build up a huge burst
+    double capacity = std::max(1.0, limits.requestsPerSecond);
+    if (state.lastRefill < 0) state.tokens = capacity;
+    else state.tokens = std::min(capacity, state.tokens + (now - state.lastRefill) * limits.requestsPerSecond / 1000.0);
+    state.lastRefill = now;
+}
+
+qint64 CurlEngine::hedgeDelay(const HostState &state) const {
+    if (state.latencies.size() < minLatencySamples) return defaultHedgeDelay;
+    auto latencies = state.latencies;
+    auto p95 = latencies.begin() + (latencies.size() * 95 + 99) / 100 - 1;
+    std::nth_element(latencies.begin(), p95, latencies.end());
+    return std::max(minHedgeDelay, *p95);
+}
+
+void CurlEngine::run() {
+    while (!m_isStopping) {
+        QList<Transfer*> pending;
+        {
+            QMutexLocker locker(&m_mutex);
+            pending.swap(m_pending);
+            if (m_limitsChanged) {
+                for (auto it = m_limits.constBegin(); it != m_limits.constEnd(); ++it) {
+                    if (m_hosts.contains(it.key()))
+                        m_hosts[it.key()].limits = it.value();
+                }
+                m_limitsChanged = false;
+            }
+        }
+        for (auto transfer : pending) {
+            hostState(transfer->host).queue.append(transfer);
+        }
+        qint64 nextTimer = handleTimers();
+        qint64 nextToken = dispatch();
+
+        int runningHandles = 0;
+        curl_multi_perform(m_multi, &runningHandles);
+
+        int messagesLeft = 0;
+        bool freedSlots = false;
+        while (CURLMsg *message = curl_multi_info_read(m_multi, &messagesLeft)) {
+            if (message->msg != CURLMSG_DONE) continue;
+            Attempt *attempt = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &attempt);
+            // A hedged sibling finishing in the same round may already have been removed
+            if (!m_running.contains(attempt)) continue;
+            // The message is invalidated once the handle is removed, so read the result first
+            CURLcode result = message->data.result;
+            finish(attempt, result);
+            freedSlots = true;
+        }
+
+        // Finished transfers free connection slots, hand them out before sleeping
+        if (freedSlots) nextToken = dispatch();
+        qint64 wait = nextTimer < 0 ? nextToken : nextToken < 0 ? nextTimer : std::min(nextTimer, nextToken);
+        int timeout = wait < 0 ? 1000 : static_cast<int>(std::clamp<qint64>(wait, 1, 1000));
+        curl_multi_poll(m_multi, nullptr, 0, timeout, nullptr);
+    }
+
+    // Nothing will drive the remaining transfers anymore
+    QList<Transfer*> transfers;
+    for (auto attempt : std::as_const(m_running)) {
+        if (!transfers.contains(attempt->transfer))
+            transfers.append(attempt->transfer);
+    }
+    for (const auto &delayed : std::as_const(m_delayed)) {
+        transfers.append(delayed.second);
+    }
+    m_delayed.clear();
+    for (auto &state : m_hosts) {
+        transfers.append(state.queue);
+        state.queue.clear();
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        transfers.append(m_pending);
+        m_pending.clear();
+    }
+    for (auto transfer : std::as_const(transfers)) {
+        fail(transfer, "Network engine shut down");
+    }
+}
+
+bool CurlEngine::start(Transfer *transfer) {
+    if (!dropCancelledWaiters(transfer)) {
+        fail(transfer, "Request canceled!");
+        return false;
+    }
+    if (!startAttempt(transfer)) {
+        fail(transfer, "Failed to initialize CURL.");
+        return false;
+    }
+    transfer->tries++;
+    const auto &request = transfer->request;
+    transfer->hedgeAt = request.retry.hedge && request.type == Client::GET
+                            ? m_clock.elapsed() + hedgeDelay(hostState(transfer->host)) : -1;
+    return true;
+}
+
+bool CurlEngine::startAttempt(Transfer *transfer) {
+    const auto &request = transfer->request;
+    auto attempt = new Attempt;
+    attempt->transfer = transfer;
+    try {
+        attempt->curl = Client::acquireCurl();
+    } catch (const MyException &) {
+        delete attempt;
+        return false;
+    }
+    auto curl = attempt->curl;
+    Client::setDefaultOpts(curl);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, attempt);
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, request.timeout);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &CurlEngine::progressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, attempt);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    if (!request.headers.isEmpty()) {
+        for (auto it = request.headers.begin(); it != request.headers.end(); ++it) {
+            std::string header = it.key().toStdString() + ": " + it.value().toStdString();
+            attempt->headers = curl_slist_append(attempt->headers, header.c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, attempt->headers);
+    }
+
+    switch (request.type) {
+    case Client::POST:
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.data.c_str());
+        break;
+    case Client::HEAD:
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        break;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &attempt->response.headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &CurlEngine::writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, attempt);
+
+    attempt->startedAt = m_clock.elapsed();
+    curl_multi_add_handle(m_multi, curl);
+    m_running.append(attempt);
+    transfer->attempts.append(attempt);
+    hostState(transfer->host).running++;
+    return true;
+}
+
+void CurlEngine::finish(Attempt *attempt, CURLcode result) {
+    auto transfer = attempt->transfer;
+    long code = 0;
+    if (result == CURLE_OK)
+        curl_easy_getinfo(attempt->curl, CURLINFO_RESPONSE_CODE, &code);
+    bool succeeded = result == CURLE_OK && !isRetryable(code);
+    if (succeeded) {
+        auto &latencies = hostState(transfer->host).latencies;
+        latencies.append(m_clock.elapsed() - attempt->startedAt);
+        if (latencies.size() > maxLatencySamples) latencies.removeFirst();
+    }
+    Client::Response response = std::move(attempt->response);
+    response.code = code;
+    removeAttempt(attempt);
+
+    if (succeeded) {
+        // First answer wins, the slower copy of a hedged request is dropped
+        const auto siblings = transfer->attempts;
+        for (auto sibling : siblings) {
+            removeAttempt(sibling);
+        }
+    } else if (!transfer->attempts.isEmpty()) {
+        return;  // The hedged copy is still running and may yet succeed
+    } else if (result != CURLE_ABORTED_BY_CALLBACK && (result == CURLE_OK || isRetryable(result)) && scheduleRetry(transfer)) {
+        return;
+    }
+
+    if (result == CURLE_ABORTED_BY_CALLBACK) {
+        fail(transfer, "Request canceled!");
+    } else if (result != CURLE_OK) {
+        fail(transfer, QString("curl_multi_perform() failed: ") + curl_easy_strerror(result));
+    } else {
+        // Retryable statuses that outlived the policy are still handed back, callers check the code themselves
+        if (transfer->request.onResponse) transfer->request.onResponse(response);
+        for (auto &waiter : detach(transfer)) {
+            waiter.promise.addResult(response);
+            waiter.promise.finish();
+        }
+        delete transfer;
+    }
+}
+
+bool CurlEngine::scheduleRetry(Transfer *transfer) {
+    const auto &request = transfer->request;
+    const auto &policy = request.retry;
+    // Only idempotent methods are safe to send again
+    if (request.type != Client::GET && request.type != Client::HEAD) return false;
+    if (transfer->tries >= policy.maxAttempts) return false;
+    if (!dropCancelledWaiters(transfer)) return false;
+
+    // Full jitter: a uniform delay up to the exponential cap keeps retries from many clients apart
+    qint64 cap = std::min<qint64>(policy.maxDelay, qint64(policy.baseDelay) << std::min(transfer->tries - 1, 20));
+    qint64 delay = QRandomGenerator::global()->bounded(cap + 1);
+    qDebug() << "Log (CurlEngine): Retrying" << request.url << "in" << delay << "ms";
+    m_delayed.append({m_clock.elapsed() + delay, transfer});
+    return true;
+}
+
+bool CurlEngine::isRetryable(CURLcode result) {
+    switch (result) {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool CurlEngine::isRetryable(long code) {
+    return code == 408 || code == 429 || code == 502 || code == 503 || code == 504;
+}
+
+void CurlEngine::removeAttempt(Attempt *attempt) {
+    auto transfer = attempt->transfer;
+    curl_multi_remove_handle(m_multi, attempt->curl);
+    m_running.removeOne(attempt);
+    transfer->attempts.removeOne(attempt);
+    hostState(transfer->host).running--;
+    if (attempt->headers)
+        curl_slist_free_all(attempt->headers);
+    Client::releaseCurl(attempt->curl);
+    delete attempt;
+}
+
+void CurlEngine::fail(Transfer *transfer, const QString &reason) {
+    const auto attempts = transfer->attempts;
+    for (auto attempt : attempts) {
+        removeAttempt(attempt);
+    }
+    for (auto &waiter : detach(transfer)) {
+        waiter.promise.setException(MyException(reason));
+        waiter.promise.finish();
+    }
+    delete transfer;
+}
+
+size_t CurlEngine::writeCallback(char *contents, size_t size, size_t nmemb, void *userp) {
+    size_t totalBytes = size * nmemb;
+    auto attempt = static_cast<Attempt*>(userp);
+    QByteArray &body = attempt->response.body;
+    if (body.isEmpty()) {
+        // Size the buffer once from Content-Length instead of growing it chunk by chunk
+        curl_off_t contentLength = -1;
+        curl_easy_getinfo(attempt->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+        if (contentLength > 0 && contentLength <= maxReservedBodySize)
+            body.reserve(static_cast<qsizetype>(contentLength));
+    }
+    body.append(contents, static_cast<qsizetype>(totalBytes));
+    return totalBytes;
+}
+
+int CurlEngine::progressCallback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    auto transfer = static_cast<Attempt*>(clientp)->transfer;
+    if (!transfer->engine->dropCancelledWaiters(transfer)) {
+        qDebug() << "Request canceled!";
+        return 1;
+    }
+    return 0;
+}
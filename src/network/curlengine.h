@@ -0,0 +1,123 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPromise>
+#include <QThread>
+#include "curl/curl.h"
+#include "network.h"
+
+// Drives every transfer of every Client on a single I/O thread through one curl_multi handle,
+// so in-flight requests cost a socket each instead of a blocked pool thread each
+class CurlEngine {
+public:
+    // Fails every queued and running transfer and joins the I/O thread. The engine is not started again,
+    // later submits fail straight away since curl_global_cleanup follows
+    static void shutdown();
+
+    static QFuture<Client::Response> submit(const Client::Request &request);
+    static void setHostLimits(const QByteArray &host, const Client::HostLimits &limits);
+
+private:
+    // Started on first use, callers must hold s_instanceMutex and check s_isShutDown
+    static CurlEngine *instance();
+    QFuture<Client::Response> enqueue(const Client::Request &request);
+    void updateHostLimits(const QByteArray &host, const Client::HostLimits &limits);
+
+    CurlEngine();
+    ~CurlEngine();
+    CurlEngine(const CurlEngine&) = delete;
+    CurlEngine& operator=(const CurlEngine&) = delete;
+
+    // Every caller attached to a transfer keeps its own promise and cancellation flag
+    struct Waiter {
+        QPromise<Client::Response> promise;
+        std::atomic<bool> *isCancelled = nullptr;
+    };
+
+    struct Transfer;
+    // One curl handle performing a transfer, a hedged transfer has two of them racing
+    struct Attempt {
+        Transfer *transfer = nullptr;
+        CURL *curl = nullptr;
+        curl_slist *headers = nullptr;
+        Client::Response response;
+        qint64 startedAt = 0;
+    };
+
+    struct Transfer {
+        CurlEngine *engine = nullptr;
+        Client::Request request;
+        QByteArray key;  // Empty for requests that must never be shared
+        std::vector<Waiter> waiters;  // Guarded by m_mutex
+        QByteArray host;
+        QList<Attempt*> attempts;  // Running attempts, only touched by the I/O thread
+        int tries = 0;  // Attempts started so far, hedges excluded
+        qint64 hedgeAt = -1;  // When to launch a second copy, -1 once hedged or if hedging is off
+    };
+
+    // Queue, connection count and token bucket of one host, only touched by the I/O thread
+    struct HostState {
+        Client::HostLimits limits;
+        QList<Transfer*> queue;
+        int running = 0;
+        double tokens = 0;
+        qint64 lastRefill = -1;
+        QList<qint64> latencies;  // Recent successful transfer times in ms, for the hedge delay
+    };
+
+    void run();
+    // Starts queued transfers within each host's limits, returns the ms until the next token frees up or -1
+    qint64 dispatch();
+    // Requeues retries that are due and launches hedges, returns the ms until the next one or -1
+    qint64 handleTimers();
+    HostState &hostState(const QByteArray &host);
+    // Tops up the host's token bucket for the time passed since the last refill
+    void refill(HostState &state, qint64 now);
+    // Returns false if the transfer was dropped instead of added to the multi handle
+    bool start(Transfer *transfer);
+    bool startAttempt(Transfer *transfer);
+    void finish(Attempt *attempt, CURLcode result);
+    void removeAttempt(Attempt *attempt);
+    void fail(Transfer *transfer, const QString &reason);
+    // Backs off with full jitter and queues the transfer again, returns false once the policy is exhausted
+    bool scheduleRetry(Transfer *transfer);
+    qint64 hedgeDelay(const HostState &state) const;
+    // Unregisters the transfer so later callers start a new one, and hands over its waiters
+    std::vector<Waiter> detach(Transfer *transfer);
+    // Fails the waiters that gave up, returns false once nobody is left waiting
+    bool dropCancelledWaiters(Transfer *transfer);
+    static QByteArray keyOf(const Client::Request &request);
+    static bool isRetryable(CURLcode result);
+    static bool isRetryable(long code);
+    static size_t writeCallback(char *contents, size_t size, size_t nmemb, void *userp);
+    static int progressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+    CURLM *m_multi = nullptr;
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_isStopping = false;
+
+    QMutex m_mutex;
+    QList<Transfer*> m_pending;  // Guarded by m_mutex, handed to the I/O thread on wake up
+    QList<Attempt*> m_running;  // Only touched by the I/O thread
+    QList<QPair<qint64, Transfer*>> m_delayed;  // Retries waiting out their backoff, only touched by the I/O thread
+    QHash<QByteArray, Transfer*> m_inflight;  // Guarded by m_mutex, identical GETs join the transfer already here
+    QHash<QByteArray, Client::HostLimits> m_limits;  // Guarded by m_mutex
+    bool m_limitsChanged = false;  // Guarded by m_mutex
+    QHash<QByteArray, HostState> m_hosts;  // Only touched by the I/O thread
+    QElapsedTimer m_clock;
+
+    // Upper bound for trusting Content-Length when pre-allocating a response body
+    inline static constexpr curl_off_t maxReservedBodySize = 64 * 1024 * 1024;
+    // Latency samples kept per host, and how many are needed before trusting their p95
+    inline static constexpr int maxLatencySamples = 64;
+    inline static constexpr int minLatencySamples = 8;
+    inline static constexpr qint64 defaultHedgeDelay = 2000;
+    inline static constexpr qint64 minHedgeDelay = 200;
+
+    inline static CurlEngine *s_instance = nullptr;
+    inline static bool s_isShutDown = false;  // Guarded by s_instanceMutex
+    inline static QMutex s_instanceMutex;
+};
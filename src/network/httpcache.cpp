@@ -0,0 +1,183 @@
+#include "httpcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+HttpCache &HttpCache::instance() {
+    static HttpCache cache;
+    return cache;
+}
+
+HttpCache::HttpCache()
+    : m_cacheDir(QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QDir::separator() + "http")) {
+    QDir().mkpath(m_cacheDir);
+    // One thread keeps writes of the same entry in order
+    m_writer.setMaxThreadCount(1);
+    prune();
+}
+
+Client::Response HttpCache::Entry::toResponse() const {
+    Client::Response response;
+    response.code = 200;
+    response.headers = headers;
+    response.body = body;
+    return response;
+}
+
+void HttpCache::setTtl(const QString &host, int seconds) {
+    QMutexLocker locker(&m_mutex);
+    m_ttls[host.toUtf8()] = seconds;
+}
+
+bool HttpCache::isCached(const QByteArray &host) const {
+    QMutexLocker locker(&m_mutex);
+    return m_ttls.contains(host);
+}
+
+QByteArray HttpCache::keyOf(const Client::Request &request) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArrayView(request.url.data(), static_cast<qsizetype>(request.url.size())));
+    for (auto it = request.headers.constBegin(); it != request.headers.constEnd(); ++it) {
+        hash.addData("\n");
+        hash.addData(it.key().toUtf8());
+        hash.addData(":");
+        hash.addData(it.value().toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+QString HttpCache::pathOf(const QByteArray &key, const char *suffix) const {
+    return m_cacheDir + QDir::separator() + QString::fromLatin1(key) + suffix;
+}
+
+std::optional<HttpCache::Entry> HttpCache::lookup(const Client::Request &request) {
+    int ttl = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_ttls.constFind(Client::hostOf(request.url));
+        if (it == m_ttls.cend()) return std::nullopt;
+        ttl = *it;
+    }
+
+    Entry entry;
+    entry.key = keyOf(request);
+    QFile metaFile(pathOf(entry.key, ".json"));
+    if (!metaFile.open(QIODevice::ReadOnly)) return std::nullopt;
+    QJsonObject meta = QJsonDocument::fromJson(metaFile.readAll()).object();
+    if (meta.isEmpty()) return std::nullopt;
+    entry.etag = meta["etag"].toString();
+    entry.lastModified = meta["lastModified"].toString();
+    entry.storedAt = meta["storedAt"].toInteger();
+    entry.headers = meta["headers"].toString();
+    entry.isFresh = ttl > 0 && QDateTime::currentSecsSinceEpoch() - entry.storedAt < ttl;
+    // A stale entry without validators cannot be revalidated, so its body is not worth reading
+    if (!entry.isFresh && entry.etag.isEmpty() && entry.lastModified.isEmpty()) return std::nullopt;
+
+    QFile bodyFile(pathOf(entry.key, ".body"));
+    if (!bodyFile.open(QIODevice::ReadOnly)) return std::nullopt;
+    entry.body = bodyFile.readAll();
+    // The writer may have replaced the body since the metadata was read
+    if (entry.body.size() != meta["size"].toInteger(-1)) return std::nullopt;
+    return entry;
+}
+
+void HttpCache::addValidators(Client::Request &request, const Entry &entry) {
+    if (!entry.etag.isEmpty())
+        request.headers["If-None-Match"] = entry.etag;
+    if (!entry.lastModified.isEmpty())
+        request.headers["If-Modified-Since"] = entry.lastModified;
+}
+
+QHash<QString, QString> HttpCache::parseHeaders(const QString &rawHeaders) {
+    QHash<QString, QString> headers;
+    const auto lines = QStringView(rawHeaders).split(u'\n');
+    for (auto line : lines) {
+        line = line.trimmed();
+        if (line.startsWith(u"HTTP/")) {
+            // Every hop of a redirect chain starts a new block, only the last one describes the body
+            headers.clear();
+            continue;
+        }
+        auto colon = line.indexOf(u':');
+        if (colon <= 0) continue;
+        headers.insert(line.left(colon).trimmed().toString().toLower(), line.mid(colon + 1).trimmed().toString());
+    }
+    return headers;
+}
+
+void HttpCache::store(const Client::Request &request, const Client::Response &response) {
+    if (request.type != Client::GET || response.code != 200) return;
+    auto headers = parseHeaders(response.headers);
+    if (headers.value("cache-control").contains("no-store", Qt::CaseInsensitive)) return;
+    // The key covers every header the request sets and curl adds none that vary, so a Vary naming request
+    // headers is already honoured. Vary: * depends on something else entirely and cannot be
+    if (headers.value("vary").contains('*')) return;
+
+    Entry entry;
+    entry.key = keyOf(request);
+    entry.etag = headers.value("etag");
+    entry.lastModified = headers.value("last-modified");
+    entry.storedAt = QDateTime::currentSecsSinceEpoch();
+    entry.headers = response.headers;
+    entry.body = response.body;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_ttls.constFind(Client::hostOf(request.url));
+        if (it == m_ttls.cend()) return;
+        // Without validators the entry could never be revalidated, so only keep it for hosts with a TTL
+        if (entry.etag.isEmpty() && entry.lastModified.isEmpty() && *it <= 0) return;
+    }
+
+    QSaveFile bodyFile(pathOf(entry.key, ".body"));
+    if (!bodyFile.open(QIODevice::WriteOnly)) return;
+    bodyFile.write(response.body);
+    if (!bodyFile.commit()) {
+        qWarning() << "Log (HttpCache): Failed to write" << bodyFile.fileName();
+        return;
+    }
+    writeMeta(entry);
+}
+
+void HttpCache::touch(const Entry &entry) {
+    Entry touched = entry;
+    touched.storedAt = QDateTime::currentSecsSinceEpoch();
+    writeMeta(touched);
+}
+
+void HttpCache::storeAsync(const Client::Request &request, const Client::Response &response) {
+    m_writer.start([this, request, response]() { store(request, response); });
+}
+
+void HttpCache::touchAsync(const Entry &entry) {
+    m_writer.start([this, entry]() { touch(entry); });
+}
+
+bool HttpCache::writeMeta(const Entry &entry) {
+    QJsonObject meta;
+    meta["etag"] = entry.etag;
+    meta["lastModified"] = entry.lastModified;
+    meta["storedAt"] = entry.storedAt;
+    meta["headers"] = entry.headers;
+    meta["size"] = entry.body.size();
+    QSaveFile metaFile(pathOf(entry.key, ".json"));
+    if (!metaFile.open(QIODevice::WriteOnly)) return false;
+    metaFile.write(QJsonDocument(meta).toJson(QJsonDocument::Compact));
+    return metaFile.commit();
+}
+
+void HttpCache::prune() {
+    // Drop entries that have not been stored or revalidated for a while so the folder does not grow forever
+    auto cutoff = QDateTime::currentDateTime().addSecs(-maxEntryAge);
+    QDirIterator it(m_cacheDir, {"*.json", "*.body"}, QDir::Files);
+    while (it.hasNext()) {
+        auto info = it.nextFileInfo();
+        if (info.lastModified() < cutoff)
+            QFile::remove(info.filePath());
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <optional>
+#include "network.h"
+
+// Keeps GET bodies on disk together with their validators so repeated requests
+// can be revalidated with a conditional request or served outright while fresh.
+// Only hosts that opted in through setTtl are cached, API and stream hosts never touch the disk
+class HttpCache {
+public:
+    struct Entry {
+        QByteArray key;
+        QString etag;
+        QString lastModified;
+        qint64 storedAt = 0;
+        bool isFresh = false;  // Within the host's TTL, served without asking the server
+        QString headers;
+        QByteArray body;
+
+        Client::Response toResponse() const;
+    };
+
+    static HttpCache &instance();
+
+    // Opts a host into caching. Pages are revalidated with their ETag/Last-Modified, and with seconds > 0
+    // also served without asking for that long, which lets hosts that send no validators be cached too
+    void setTtl(const QString &host, int seconds);
+    bool isCached(const QByteArray &host) const;
+
+    // Only the metadata is read while deciding, the body is read when the entry is usable
+    std::optional<Entry> lookup(const Client::Request &request);
+    // Adds If-None-Match/If-Modified-Since so the server can answer with a 304
+    static void addValidators(Client::Request &request, const Entry &entry);
+    // Stores a response, or restarts the TTL of an entry the server confirmed with a 304, on the cache's
+    // own writer thread so callers on the curl engine thread never wait on the disk
+    void storeAsync(const Client::Request &request, const Client::Response &response);
+    void touchAsync(const Entry &entry);
+    // Blocks until queued writes are on disk, called on shutdown
+    void waitForWrites() { m_writer.waitForDone(); }
+
+private:
+    // Only run on the writer thread, which also keeps the files of one entry from being written concurrently
+    void store(const Client::Request &request, const Client::Response &response);
+    void touch(const Entry &entry);
+
+    HttpCache();
+    HttpCache(const HttpCache&) = delete;
+    HttpCache& operator=(const HttpCache&) = delete;
+
+    static QByteArray keyOf(const Client::Request &request);
+    // Headers of the final response in a redirect chain, keyed by lower case name
+    static QHash<QString, QString> parseHeaders(const QString &rawHeaders);
+    QString pathOf(const QByteArray &key, const char *suffix) const;
+    bool writeMeta(const Entry &entry);
+    void prune();
+
+    const QString m_cacheDir;
+    QHash<QByteArray, int> m_ttls;
+    mutable QMutex m_mutex;  // Guards m_ttls, files are replaced atomically and read without it
+    QThreadPool m_writer;
+
+    inline static constexpr qint64 maxEntryAge = 14 * 24 * 60 * 60;
+};
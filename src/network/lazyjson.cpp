@@ -0,0 +1,236 @@
+#include "lazyjson.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+const char *skipSpace(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+// p points at the opening quote, returns the position after the closing one
+const char *skipString(const char *p, const char *end) {
+    for (++p; p < end; ++p) {
+        if (*p == '\\') ++p;
+        else if (*p == '"') return p + 1;
+    }
+    return end;
+}
+
+// Skips one value of any kind without looking inside it beyond bracket depth and strings
+const char *skipValue(const char *p, const char *end) {
+    if (p >= end) return end;
+    if (*p == '"') return skipString(p, end);
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                p = skipString(p, end);
+                continue;
+            }
+            if (c == '{' || c == '[') depth++;
+            else if ((c == '}' || c == ']') && --depth == 0) return p + 1;
+            ++p;
+        }
+        return end;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') p++;
+    return p;
+}
+
+QString decodeString(QByteArrayView quoted) {
+    // Strip the quotes, the common escape free case is a single UTF-8 conversion
+    QByteArrayView raw = quoted.sliced(1, quoted.size() >= 2 ? quoted.size() - 2 : 0);
+    if (!raw.contains('\\')) return QString::fromUtf8(raw);
+    QString out;
+    out.reserve(raw.size());
+    qsizetype pos = 0;
+    while (pos < raw.size()) {
+        qsizetype slash = raw.indexOf('\\', pos);
+        if (slash < 0) slash = raw.size();
+        out += QString::fromUtf8(raw.sliced(pos, slash - pos));
+        if (slash + 1 >= raw.size()) break;
+        char escape = raw[slash + 1];
+        pos = slash + 2;
+        switch (escape) {
+        case 'n': out += u'\n'; break;
+        case 't': out += u'\t'; break;
+        case 'r': out += u'\r'; break;
+        case 'b': out += u'\b'; break;
+        case 'f': out += u'\f'; break;
+        case 'u': {
+            bool ok = false;
+            ushort unit = pos + 4 <= raw.size() ? raw.sliced(pos, 4).toByteArray().toUShort(&ok, 16) : 0;
+            if (ok) {
+                // Surrogate pairs arrive as two escapes and simply end up as two UTF-16 units
+                out += QChar(unit);
+                pos += 4;
+            }
+            break;
+        }
+        default: out += QLatin1Char(escape); break;
+        }
+    }
+    return out;
+}
+
+bool keyEquals(QByteArrayView quotedKey, QByteArrayView key) {
+    QByteArrayView raw = quotedKey.sliced(1, quotedKey.size() >= 2 ? quotedKey.size() - 2 : 0);
+    if (!raw.contains('\\')) return raw == key;
+    return decodeString(quotedKey) == QString::fromUtf8(key);
+}
+
+QByteArrayView member(QByteArrayView object, QByteArrayView key) {
+    if (!object.startsWith('{')) return {};
+    const char *end = object.data() + object.size();
+    const char *p = skipSpace(object.data() + 1, end);
+    while (p < end && *p == '"') {
+        const char *keyEnd = skipString(p, end);
+        bool found = keyEquals(QByteArrayView(p, keyEnd - p), key);
+        p = skipSpace(keyEnd, end);
+        if (p >= end || *p != ':') return {};
+        p = skipSpace(p + 1, end);
+        const char *valueEnd = skipValue(p, end);
+        if (found) return QByteArrayView(p, valueEnd - p);
+        p = skipSpace(valueEnd, end);
+        if (p < end && *p == ',') p = skipSpace(p + 1, end);
+    }
+    return {};
+}
+
+template <typename Callback>
+void forEachElement(QByteArrayView container, Callback callback) {
+    if (!container.startsWith('[') && !container.startsWith('{')) return;
+    bool isObject = container.startsWith('{');
+    const char *end = container.data() + container.size();
+    const char *p = skipSpace(container.data() + 1, end);
+    while (p < end && *p != ']' && *p != '}') {
+        if (isObject) {
+            p = skipSpace(skipString(p, end), end);
+            if (p >= end || *p != ':') return;
+            p = skipSpace(p + 1, end);
+        }
+        const char *valueEnd = skipValue(p, end);
+        if (!callback(QByteArrayView(p, valueEnd - p))) return;
+        p = skipSpace(valueEnd, end);
+        if (p < end && *p == ',') p = skipSpace(p + 1, end);
+    }
+}
+
+// Resolves the path from pos on, appending every match; [*] fans out over all array items
+void resolve(QByteArrayView value, QByteArrayView path, qsizetype pos, QList<QByteArrayView> &out) {
+    while (pos < path.size()) {
+        if (value.isEmpty()) return;
+        if (path[pos] == '.') {
+            pos++;
+            continue;
+        }
+        if (path[pos] == '[') {
+            qsizetype close = path.indexOf(']', pos);
+            if (close < 0) return;
+            QByteArrayView index = path.sliced(pos + 1, close - pos - 1);
+            pos = close + 1;
+            if (index == "*") {
+                forEachElement(value, [&](QByteArrayView element) {
+                    resolve(element, path, pos, out);
+                    return true;
+                });
+                return;
+            }
+            bool ok = false;
+            int n = index.toByteArray().toInt(&ok);
+            if (!ok) return;
+            QByteArrayView found;
+            int i = 0;
+            forEachElement(value, [&](QByteArrayView element) {
+                if (i++ != n) return true;
+                found = element;
+                return false;
+            });
+            value = found;
+            continue;
+        }
+        qsizetype next = pos;
+        while (next < path.size() && path[next] != '.' && path[next] != '[') next++;
+        value = member(value, path.sliced(pos, next - pos));
+        pos = next;
+    }
+    if (!value.isEmpty()) out.append(value);
+}
+}
+
+LazyJson::LazyJson(const QByteArray &json) {
+    const char *begin = json.constData();
+    const char *end = begin + json.size();
+    const char *p = skipSpace(begin, end);
+    const char *valueEnd = skipValue(p, end);
+    m_root = Value(json, QByteArrayView(p, valueEnd - p));
+}
+
+LazyJson::Value LazyJson::Value::at(QByteArrayView path) const {
+    QList<QByteArrayView> found;
+    resolve(m_raw, path, 0, found);
+    return found.isEmpty() ? Value() : Value(m_source, found.first());
+}
+
+QList<LazyJson::Value> LazyJson::Value::all(QByteArrayView path) const {
+    QList<QByteArrayView> found;
+    resolve(m_raw, path, 0, found);
+    QList<Value> values;
+    values.reserve(found.size());
+    for (auto raw : found) {
+        values.append(Value(m_source, raw));
+    }
+    return values;
+}
+
+QList<LazyJson::Value> LazyJson::Value::elements() const {
+    QList<Value> values;
+    forEachElement(m_raw, [&](QByteArrayView element) {
+        values.append(Value(m_source, element));
+        return true;
+    });
+    return values;
+}
+
+QString LazyJson::Value::toString(const QString &defaultValue) const {
+    if (!isValid() || isNull() || isObject() || isArray()) return defaultValue;
+    if (isString()) return decodeString(m_raw);
+    return QString::fromUtf8(m_raw);
+}
+
+qint64 LazyJson::Value::toInteger(qint64 defaultValue) const {
+    if (!isValid() || isNull()) return defaultValue;
+    bool ok = false;
+    QByteArray literal = isString() ? m_raw.sliced(1, m_raw.size() - 2).toByteArray() : m_raw.toByteArray();
+    qint64 value = literal.toLongLong(&ok);
+    if (ok) return value;
+    double real = literal.toDouble(&ok);
+    return ok ? static_cast<qint64>(real) : defaultValue;
+}
+
+double LazyJson::Value::toDouble(double defaultValue) const {
+    if (!isValid() || isNull()) return defaultValue;
+    bool ok = false;
+    QByteArray literal = isString() ? m_raw.sliced(1, m_raw.size() - 2).toByteArray() : m_raw.toByteArray();
+    double value = literal.toDouble(&ok);
+    return ok ? value : defaultValue;
+}
+
+bool LazyJson::Value::toBool(bool defaultValue) const {
+    if (m_raw == "true") return true;
+    if (m_raw == "false") return false;
+    return defaultValue;
+}
+
+QJsonValue LazyJson::Value::toJson() const {
+    if (!isValid()) return QJsonValue(QJsonValue::Undefined);
+    if (isObject()) return QJsonDocument::fromJson(m_raw.toByteArray()).object();
+    if (isArray()) return QJsonDocument::fromJson(m_raw.toByteArray()).array();
+    if (isNull()) return QJsonValue(QJsonValue::Null);
+    if (isString()) return toString();
+    if (m_raw == "true" || m_raw == "false") return toBool();
+    return toDouble();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <QByteArray>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+
+// On-demand reader over a raw JSON body. Paths are resolved by scanning the bytes and skipping every
+// subtree that is not on the way, no DOM is built and only the values actually read are decoded.
+// Paths are dot separated keys with optional [n] or [*] indices, e.g. "data.shows.edges[*].name"
+class LazyJson {
+public:
+    class Value {
+    public:
+        Value() = default;
+
+        bool isValid() const { return !m_raw.isEmpty(); }
+        bool isNull() const { return m_raw == "null"; }
+        bool isString() const { return m_raw.startsWith('"'); }
+        bool isObject() const { return m_raw.startsWith('{'); }
+        bool isArray() const { return m_raw.startsWith('['); }
+
+        // Numbers and booleans come back as their literal text, objects and arrays as the default
+        QString toString(const QString &defaultValue = {}) const;
+        // Numeric strings such as "12" are accepted as well, providers are not consistent about quoting
+        qint64 toInteger(qint64 defaultValue = 0) const;
+        int toInt(int defaultValue = 0) const { return static_cast<int>(toInteger(defaultValue)); }
+        double toDouble(double defaultValue = 0) const;
+        bool toBool(bool defaultValue = false) const;
+        // Builds a QJsonValue for this subtree only, for code that still needs the Qt types
+        QJsonValue toJson() const;
+
+        Value at(QByteArrayView path) const;
+        QList<Value> all(QByteArrayView path) const;
+        // Items of an array, values of an object
+        QList<Value> elements() const;
+        QByteArrayView raw() const { return m_raw; }
+
+    private:
+        friend class LazyJson;
+        Value(const QByteArray &source, QByteArrayView raw) : m_source(source), m_raw(raw) {}
+        QByteArray m_source;  // Keeps the scanned buffer alive, shared and never copied
+        QByteArrayView m_raw;
+    };
+
+    explicit LazyJson(const QByteArray &json);
+
+    Value root() const { return m_root; }
+    Value at(QByteArrayView path) const { return m_root.at(path); }
+    QList<Value> all(QByteArrayView path) const { return m_root.all(path); }
+
+private:
+    Value m_root;
+};
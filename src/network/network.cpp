@@ -1,5 +1,7 @@
 #include "network.h"
 #include "myexception.h"
+#include "curlengine.h"
+#include "httpcache.h"
 #include <utils/errorhandler.h>
 
 
@@ -14,124 +16,230 @@ void Client::setDefaultOpts(CURL *curl) {
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
         // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &HeaderCallback);
         // curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
         curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 50L);
-        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
-        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+        // Keep idle connections in the shared connection cache alive between requests
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+        curl_easy_setopt(curl, CURLOPT_SHARE, share());
     }
 }
 
-
-bool Client::isOk(const QString &url, const QHash<QString, QString> &headers, long timeout) {
-    auto m_curl = curl_easy_init();
-    if (!m_curl) {
-        throw MyException("Failed to initialize CURL.");
+CURLSH *Client::share() {
+    // Created on first use and again after cleanupCurls(), so a late request never sees a freed handle
+    QMutexLocker locker(&mutex);
+    if (!m_share) {
+        m_share = curl_share_init();
+        curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &Client::lockShare);
+        curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &Client::unlockShare);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        // Safe now that every transfer is performed by the single curl engine thread
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
     }
-    setDefaultOpts(m_curl);
-    auto urlString = url.toStdString();
-    curl_easy_setopt(m_curl, CURLOPT_URL, urlString.c_str());
-    curl_easy_setopt(m_curl, CURLOPT_TIMEOUT, timeout);
-    curl_easy_setopt(m_curl, CURLOPT_NOBODY, 1L);
-    struct curl_slist* curlHeaders = NULL;
-    if (!headers.isEmpty()) {
-        for(auto it = headers.begin(); it != headers.end(); ++it) {
-            std::string header = it.key().toStdString() + ": " + it.value().toStdString();
-            curlHeaders = curl_slist_append(curlHeaders, header.c_str());
-        }
-        curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, curlHeaders);
-    }
-    CURLcode res = curl_easy_perform(m_curl);
-    if (res != CURLE_OK){
-        return false;
+    return m_share;
+}
+
+void Client::lockShare(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    shareMutexes[data].lock();
+}
+
+void Client::unlockShare(CURL *handle, curl_lock_data data, void *userptr) {
+    shareMutexes[data].unlock();
+}
+
+QByteArray Client::hostOf(const std::string &url) {
+    return QUrl(QString::fromStdString(url)).host().toUtf8();
+}
+
+CURL *Client::acquireCurl() {
+    {
+        QMutexLocker locker(&mutex);
+        if (!m_curls.isEmpty())
+            return m_curls.takeLast();
     }
-    long code;
-    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &code);
-    if (curlHeaders)
-        curl_slist_free_all(curlHeaders);
-    curl_easy_cleanup(m_curl);
-    return code == 200;
-}
-
-Client::Response Client::request(int type, const std::string &url, const QMap<QString, QString> &headersMap, const std::string &postData){
-    auto m_curl = curl_easy_init();
-    if (!m_curl) {
-        throw MyException("Failed to get curl");
+    auto curl = curl_easy_init();
+    if (!curl) {
+        throw MyException("Failed to initialize CURL.");
     }
-    setDefaultOpts(m_curl);
-
+    return curl;
+}
 
-    if (m_isCancelled) {
-        if (*m_isCancelled)
-            throw MyException("Request canceled!");
-        curl_easy_setopt(m_curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
-        curl_easy_setopt(m_curl, CURLOPT_XFERINFODATA, this);
-        curl_easy_setopt(m_curl, CURLOPT_NOPROGRESS, 0L);
+void Client::releaseCurl(CURL *curl) {
+    if (!curl) return;
+    curl_easy_reset(curl);
+    QMutexLocker locker(&mutex);
+    if (m_curls.size() >= maxIdleCurls) {
+        locker.unlock();
+        curl_easy_cleanup(curl);
+        return;
     }
+    m_curls.append(curl);
+}
 
+void Client::cleanupCurls() {
+    CurlEngine::shutdown();
+    QMutexLocker locker(&mutex);
+    for (auto curl : std::as_const(m_curls)) {
+        curl_easy_cleanup(curl);
+    }
+    m_curls.clear();
+    if (m_share) {
+        curl_share_cleanup(m_share);
+        m_share = nullptr;
+    }
+}
 
-    Response response;
+void Client::setHostLimits(const QString &host, const HostLimits &limits) {
+    CurlEngine::setHostLimits(host.toUtf8(), limits);
+}
 
-    curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
+bool Client::isOk(const QString &url, const QHash<QString, QString> &headers, long timeout) {
+    return isOkAsync(url, headers, timeout).result();
+}
 
-    struct curl_slist* curlHeaders = NULL;
-    if (!headersMap.isEmpty()) {
-        for(auto it = headersMap.begin(); it != headersMap.end(); ++it) {
-            std::string header = it.key().toStdString() + ": " + it.value().toStdString();
-            curlHeaders = curl_slist_append(curlHeaders, header.c_str());
+QFuture<bool> Client::isOkAsync(const QString &url, const QHash<QString, QString> &headers, long timeout) {
+    {
+        QMutexLocker locker(&m_validationMutex);
+        auto it = m_validations.constFind(url);
+        if (it != m_validations.cend() && it->expiresAt > QDateTime::currentDateTimeUtc()) {
+            QPromise<bool> promise;
+            promise.start();
+            promise.addResult(it->isOk);
+            promise.finish();
+            return promise.future();
         }
-        curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, curlHeaders);
     }
 
+    QMap<QString, QString> headersMap;
+    for (auto it = headers.begin(); it != headers.end(); ++it) {
+        headersMap.insert(it.key(), it.value());
+    }
+    auto request = makeRequest(HEAD, url.toStdString(), headersMap, "", timeout);
+    // A dead server should not cost the full backoff schedule on top of its timeouts
+    request.retry.maxAttempts = std::min(request.retry.maxAttempts, 2);
+    auto isCancelled = m_isCancelled;
+    return send(request).then([url](const Response &response) {
+        bool isOk = response.code == 200;
+        rememberValidation(url, isOk);
+        return isOk;
+    }).onFailed([url, isCancelled]() {
+        // A cancelled probe says nothing about the URL
+        if (!(isCancelled && *isCancelled))
+            rememberValidation(url, false);
+        return false;
+    });
+}
 
-    switch (type) {
-    case POST:
-        // std::string dataString = postData.toStdString();
-        curl_easy_setopt(m_curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(m_curl, CURLOPT_POSTFIELDS, postData.c_str());
-        break;
+void Client::rememberValidation(const QString &url, bool isOk) {
+    auto now = QDateTime::currentDateTimeUtc();
+    QMutexLocker locker(&m_validationMutex);
+    if (m_validations.size() > 1024) {
+        m_validations.removeIf([&now](const auto &it) { return it.value().expiresAt <= now; });
     }
+    m_validations.insert(url, {isOk, now.addSecs(isOk ? validationTtl : failedValidationTtl)});
+}
 
-    // Set the response callback function
-    curl_easy_setopt(m_curl, CURLOPT_HEADERDATA, &response.headers);
-    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &response.body);
+QFuture<Client::Response> Client::request(int type, const std::string &url, const QMap<QString, QString> &headersMap, const std::string &postData, long timeout){
+    return send(makeRequest(type, url, headersMap, postData, timeout));
+}
 
-    qDebug() << (type == GET ? "[GET]: ":"[POST]") << url;
+Client::Request Client::makeRequest(int type, const std::string &url, const QMap<QString, QString> &headersMap, const std::string &postData, long timeout) const {
+    Request request;
+    request.type = type;
+    request.url = url;
+    request.headers = headersMap;
+    request.data = postData;
+    request.timeout = timeout;
+    request.isCancelled = m_isCancelled;
+    request.retry = m_retryPolicy;
+    return request;
+}
 
-    //qDebug() << m_curl;
-    // Perform the request
-    CURLcode res = curl_easy_perform(m_curl);
+QFuture<Client::Response> Client::send(const Request &request) {
+    const auto type = request.type;
+    const auto &url = request.url;
+    qDebug() << (type == GET ? "[GET]: " : type == POST ? "[POST]" : "[HEAD]") << url;
+    if (type == GET)
+        return cachedGet(request);
+    return CurlEngine::submit(request);
+}
 
-    // Check for errors
-    if (res != CURLE_OK){
-        throw MyException(QString("curl_easy_perform() failed: ") + curl_easy_strerror(res));
+QFuture<Client::Response> Client::cachedGet(Request request) {
+    auto &cache = HttpCache::instance();
+    if (!cache.isCached(hostOf(request.url)))
+        return CurlEngine::submit(request);
+    auto entry = cache.lookup(request);
+    if (entry && entry->isFresh) {
+        qDebug() << "Log (HttpCache): Fresh hit for" << request.url;
+        return readyFuture(entry->toResponse());
     }
 
-    // Get the response code
-    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &response.code);
+    // The cache key is taken from the caller's headers, not the conditional ones added below
+    Request conditional = request;
+    if (entry) HttpCache::addValidators(conditional, *entry);
+    // Disk work happens once per transfer and off the engine thread, the continuation below runs per caller
+    conditional.onResponse = [request, entry](const Response &response) {
+        if (response.code == 304 && entry)
+            HttpCache::instance().touchAsync(*entry);
+        else
+            HttpCache::instance().storeAsync(request, response);
+    };
+    return CurlEngine::submit(conditional).then([entry](Response response) {
+        if (response.code == 304 && entry) {
+            return entry->toResponse();
+        }
+        return response;
+    });
+}
 
-    // Clean up
-    if (curlHeaders)
-        curl_slist_free_all(curlHeaders);
+QFuture<Client::Response> Client::readyFuture(Response response) {
+    QPromise<Response> promise;
+    promise.start();
+    promise.addResult(std::move(response));
+    promise.finish();
+    return promise.future();
+}
+
+Client::Response Client::get(const QString &url, const QMap<QString, QString> &headers, const QMap<QString, QString> &params) {
+    return getAsync(url, headers, params).result();
+}
 
-    curl_easy_cleanup(m_curl);
+Client::Response Client::post(const QString &url, const QMap<QString, QString> &data, const QMap<QString, QString> &headers){
+    return postAsync(url, data, headers).result();
+}
 
+Client::Response Client::getHtml(const QString &url, const QMap<QString, QString> &headers, const QMap<QString, QString> &params) {
+    auto response = get(url, headers, params);
+    response.document = CSoup::readDocument(response.body);
     return response;
 }
 
-Client::Response Client::get(const QString &url, const QMap<QString, QString> &headers, const QMap<QString, QString> &params) {
+std::string Client::withParams(const QString &url, const QMap<QString, QString> &params) {
     auto fullUrl = url;
     if (!params.isEmpty()) {
         for (auto it = params.constBegin(); it != params.constEnd(); ++it) {
             fullUrl += "&" + it.key() + "=" + it.value();
         }
     }
-    auto urlString = url.toStdString();
-    return request(GET, fullUrl.toStdString(), headers);
+    return fullUrl.toStdString();
 }
 
-Client::Response Client::post(const QString &url, const QMap<QString, QString> &data, const QMap<QString, QString> &headers){
+QFuture<Client::Response> Client::getAsync(const QString &url, const QMap<QString, QString> &headers, const QMap<QString, QString> &params) {
+    return request(GET, withParams(url, params), headers);
+}
+
+QFuture<Client::Response> Client::getHtmlAsync(const QString &url, const QMap<QString, QString> &headers, const QMap<QString, QString> &params) {
+    // Launch::Async keeps the parse off the engine thread that completes the transfer
+    return getAsync(url, headers, params).then(QtFuture::Launch::Async, [](Response response) {
+        response.document = CSoup::readDocument(response.body);
+        return response;
+    });
+}
+
+QFuture<Client::Response> Client::postAsync(const QString &url, const QMap<QString, QString> &data, const QMap<QString, QString> &headers){
     QString postData;
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         postData += it.key() + "=" + it.value() + "&";
@@ -139,23 +247,6 @@ Client::Response Client::post(const QString &url, const QMap<QString, QString> &
     return request(POST, url.toStdString(), headers, postData.toStdString());
 }
 
-size_t Client::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    size_t totalBytes(size * nmemb);
-
-    // Cast userp to QString pointer
-    QString* str = static_cast<QString*>(userp);
-
-    // Convert the incoming data to QString assuming it's UTF-8 encoded
-    // If your data is in another encoding, adjust this part accordingly
-    QString newData = QString::fromUtf8(static_cast<char*>(contents), static_cast<int>(totalBytes));
-
-    // Append the new data to the provided QString
-    str->append(newData);
-
-    // Return the number of bytes taken care of
-    return totalBytes;
-}
-
 size_t Client::HeaderCallback(char *buffer, size_t size, size_t nitems, void *userdata) {
     // Calculate the total size of the incoming header data
     size_t numbytes = size * nitems;
@@ -7,8 +7,15 @@
 #include <QTimer>
 #include "curl/curl.h"
 #include "csoup.h"
+#include "lazyjson.h"
 #include "myexception.h"
 #include <QJsonArray>
+#include <QHash>
+#include <QDateTime>
+#include <QUrl>
+#include <QFuture>
+#include <optional>
+#include <functional>
 
 class Client {
 public:
@@ -27,12 +34,22 @@ public:
         QString redirectUrl;
         //        QMap<QString, QString> headers;
         QString headers;
-        QString body;
+        // Raw bytes as received, handed to QJsonDocument and libxml2 without transcoding
+        QByteArray body;
         QMap<QString, QString> cookies;
+        // Set by getHtml/getHtmlAsync, parsed once the body is complete and never on the engine thread
+        std::shared_ptr<xmlDoc> document;
+
+        // Decodes the body once on first use, for callers that really need text
+        const QString &text() const {
+            if (!m_text)
+                m_text = QString::fromUtf8(body);
+            return *m_text;
+        }
 
         QJsonObject toJsonObject(){
             QJsonParseError error;
-            QJsonDocument jsonData = QJsonDocument::fromJson(body.toUtf8(), &error);
+            QJsonDocument jsonData = QJsonDocument::fromJson(body, &error);
             if (error.error != QJsonParseError::NoError) {
                 qWarning() << "JSON parsing error:" << error.errorString();
                 return QJsonObject{};
@@ -41,76 +58,118 @@ public:
         }
         QJsonArray toJsonArray(){
             QJsonParseError error;
-            QJsonDocument jsonData = QJsonDocument::fromJson(body.toUtf8(), &error);
+            QJsonDocument jsonData = QJsonDocument::fromJson(body, &error);
             if (error.error != QJsonParseError::NoError) {
                 qWarning() << "JSON parsing error:" << error.errorString();
                 return {};
             }
             return jsonData.array();
         }
+        // Scans the body on demand instead of building a QJsonDocument, for large API payloads
+        // where only a few fields are read
+        LazyJson json() const { return LazyJson(body); }
         CSoup toSoup(){
+            if (document) return CSoup::fromDocument(document);
             return CSoup::parse(body);
         }
 
         ~Response(){}
+    private:
+        mutable std::optional<QString> m_text;
     };
-    Client(std::atomic<bool>* shouldCancel): m_isCancelled(shouldCancel) {
-        // QMutexLocker locker(&mutex);
-        // if (m_curls.isEmpty()) {
-        //     qDebug() << "m_curls is empty";
-        //     QTimer timer;
-        //     timer.setInterval(100);
-        //     QEventLoop loop;
-        //     QObject::connect(&timer, &QTimer::timeout, [&]() {
-        //         if (!m_curls.isEmpty()) {
-        //             qDebug() << "List is no longer empty!";
-        //             loop.quit();
-        //         }
-        //     });
-        //     timer.start();
-        //     loop.exec();
-        // }
-        // m_curl = m_curls.last();
-        // m_curls.removeLast();
-    }
+    // Per-host throttling, requests over the limits wait in the engine's queue instead of failing
+    struct HostLimits {
+        int maxConnections = 6;
+        double requestsPerSecond = 0;  // 0 disables the token bucket
+    };
+    // Failed GET/HEAD transfers are retried with exponential backoff and full jitter,
+    // hedging additionally races a second copy of a GET that runs past the host's p95 latency
+    struct RetryPolicy {
+        int maxAttempts = 3;
+        int baseDelay = 250;  // ms
+        int maxDelay = 4000;  // ms
+        bool hedge = false;
+    };
+    struct Request {
+        int type = GET;
+        std::string url;
+        QMap<QString, QString> headers;
+        std::string data;
+        long timeout = 20L;
+        std::atomic<bool> *isCancelled = nullptr;
+        RetryPolicy retry;
+        // Called once per transfer on the engine thread, however many callers share it. Must not block
+        std::function<void(const Response&)> onResponse;
+    };
+    Client(std::atomic<bool>* shouldCancel): m_isCancelled(shouldCancel) {}
     void setShouldCancel(std::atomic<bool>* shouldCancel) {
         m_isCancelled = shouldCancel;
     }
-    // ~Client() {
-    //     Q_ASSERT(m_curl);
-    //     QMutexLocker locker(&mutex);
-    //     curl_easy_reset (m_curl);
-    //     m_curls.push_back(m_curl);
-    //     qDebug() << "returned";
-    // }
+    void setRetryPolicy(const RetryPolicy &policy) {
+        m_retryPolicy = policy;
+    }
+    bool isCancelled() const { return m_isCancelled && *m_isCancelled; }
+
+    // Cleans up every pooled curl handle and the share object, must be called before curl_global_cleanup
+    static void cleanupCurls();
+    static void setHostLimits(const QString &host, const HostLimits &limits);
 
     bool isOk(const QString& url, const QHash<QString, QString> &headers = {}, long timeout = 5L);
+    // HEAD probe that does not block, results are remembered per URL for a short while so reloading
+    // a server does not probe its sources again
+    QFuture<bool> isOkAsync(const QString& url, const QHash<QString, QString> &headers = {}, long timeout = 5L);
+    inline static int validationTtl = 120;       // Seconds a working URL is trusted
+    inline static int failedValidationTtl = 20;  // Seconds a failing URL is not retried
+    // The synchronous calls block the calling thread on the async ones, the transfer itself runs on the curl engine thread
     Response get(const QString &url, const  QMap<QString, QString>& headers={}, const QMap<QString, QString>& params = {});
     Response post(const QString &url, const QMap<QString, QString>& data={}, const QMap<QString, QString>& headers={});
+    QFuture<Response> getAsync(const QString &url, const  QMap<QString, QString>& headers={}, const QMap<QString, QString>& params = {});
+    QFuture<Response> postAsync(const QString &url, const QMap<QString, QString>& data={}, const QMap<QString, QString>& headers={});
+    // Same as get, but the body is parsed into the response's document so toSoup() returns without a parse step.
+    // getHtml parses on the calling thread, getHtmlAsync on a pool thread once the transfer completes
+    Response getHtml(const QString &url, const QMap<QString, QString>& headers={}, const QMap<QString, QString>& params = {});
+    QFuture<Response> getHtmlAsync(const QString &url, const QMap<QString, QString>& headers={}, const QMap<QString, QString>& params = {});
 private:
-    Response request(int type, const std::string &url, const QMap<QString, QString>& headersMap={}, const std::string &data = "");
+    friend class CurlEngine;
+    friend class HttpCache;
+    QFuture<Response> request(int type, const std::string &url, const QMap<QString, QString>& headersMap={}, const std::string &data = "", long timeout = 20L);
+    static std::string withParams(const QString &url, const QMap<QString, QString> &params);
+    Request makeRequest(int type, const std::string &url, const QMap<QString, QString>& headersMap, const std::string &data, long timeout) const;
+    static QFuture<Response> send(const Request &request);
 
     std::atomic<bool> *m_isCancelled;
-    // CURL* m_curl;
+    RetryPolicy m_retryPolicy;
 
+    // For hosts that opted into the on-disk cache, answers GETs from it while fresh, otherwise revalidates
+    // them and maps a 304 to the cached body. Other hosts go straight to the engine
+    static QFuture<Response> cachedGet(Request request);
+    static QFuture<Response> readyFuture(Response response);
 
+    struct Validation {
+        bool isOk;
+        QDateTime expiresAt;
+    };
+    static void rememberValidation(const QString &url, bool isOk);
+    inline static QHash<QString, Validation> m_validations;
+    inline static QMutex m_validationMutex;
 
-    void setDefaultOpts(CURL* curl);
-    static int progress_callback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
-        Client* handler = static_cast<Client*>(clientp);
-        std::atomic<bool> *shouldCancel = handler->m_isCancelled;
-        if (shouldCancel && *shouldCancel) {
-            qDebug() << "Request canceled!";
-            throw MyException("Request canceled!");
-            return 1;
-        }
-        return 0;
-    }
-    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
+    static void setDefaultOpts(CURL* curl);
     static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata);
-    // inline static QList<CURL*> m_curls;
-    // inline static QMutex mutex;
-    // inline static bool initialised = false;
-};
 
+    // Idle easy handles are reused to save their setup. Connections are not tied to a handle, attached to the
+    // engine's multi handle they all go through the multi's and the share's connection cache, so any handle will do
+    static CURL *acquireCurl();
+    static void releaseCurl(CURL *curl);
+    static QByteArray hostOf(const std::string &url);
+    inline static QList<CURL*> m_curls;
+    inline static constexpr int maxIdleCurls = 32;
+    inline static QMutex mutex;
 
+    // Process-wide share object so every Client, whichever manager owns it,
+    // reuses the DNS results, TLS session tickets and connections warmed up by the others
+    static CURLSH *share();
+    static void lockShare(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr);
+    static void unlockShare(CURL *handle, curl_lock_data data, void *userptr);
+    inline static CURLSH *m_share = nullptr;
+    inline static QMutex shareMutexes[CURL_LOCK_DATA_LAST];
+};
@@ -336,6 +336,8 @@ void MpvObject::onMpvEvent() {
         case MPV_EVENT_END_FILE: {
             mpv_event_end_file *ef = static_cast<mpv_event_end_file *>(event->data);
             handleMpvError(ef->error);
+            if (ef->reason == MPV_END_FILE_REASON_ERROR)
+                emit playbackFailed();
             m_endFileReason = static_cast<mpv_end_file_reason>(ef->reason);
             if (m_isLoading){
                 m_isLoading = false;
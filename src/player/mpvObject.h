@@ -112,6 +112,7 @@ signals:
     void speedChanged(void);
     void videoSizeChanged(void);
     void playNext(void);
+    void playbackFailed(void);
     void shouldSkipOPChanged(void);
     void shouldSkipEDChanged(void);
     void audioTracksChanged(void);
@@ -0,0 +1,101 @@
+#include "playinfocache.h"
+#include <QRegularExpression>
+#include <QTimeZone>
+#include <QUrlQuery>
+
+PlayInfoCache &PlayInfoCache::instance() {
+    static PlayInfoCache cache;
+    return cache;
+}
+
+std::optional<PlayInfoCache::Entry> PlayInfoCache::find(const QString &provider, const QString &episodeLink) {
+    auto now = QDateTime::currentDateTimeUtc();
+    QMutexLocker locker(&m_mutex);
+    auto it = m_slots.find(keyOf(provider, episodeLink));
+    if (it == m_slots.end()) return std::nullopt;
+    if (it->playInfo && it->playInfoExpireAt <= now) it->playInfo.reset();
+    if (it->serversExpireAt <= now) {
+        m_slots.erase(it);
+        return std::nullopt;
+    }
+    return Entry{it->servers, it->playInfo};
+}
+
+QDateTime PlayInfoCache::sourcesExpireAt(const QString &provider, const QString &episodeLink) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_slots.constFind(keyOf(provider, episodeLink));
+    if (it == m_slots.cend() || !it->playInfo) return QDateTime();
+    return it->playInfoExpireAt;
+}
+
+void PlayInfoCache::storeServers(const QString &provider, const QString &episodeLink, const QList<VideoServer> &servers) {
+    QMutexLocker locker(&m_mutex);
+    auto &slot = m_slots[keyOf(provider, episodeLink)];
+    slot.servers = servers;
+    slot.serversExpireAt = QDateTime::currentDateTimeUtc().addSecs(serversTtl);
+    evict();
+}
+
+void PlayInfoCache::store(const QString &provider, const QString &episodeLink, const QList<VideoServer> &servers,
+                          const PlayInfo &playInfo, int ttl) {
+    auto now = QDateTime::currentDateTimeUtc();
+    auto expireAt = now.addSecs(ttl);
+    for (const auto &video : playInfo.sources) {
+        auto signedExpiry = expiryOf(video.videoUrl);
+        if (signedExpiry.isValid()) expireAt = std::min(expireAt, signedExpiry.addSecs(-expiryMargin));
+    }
+    QMutexLocker locker(&m_mutex);
+    auto &slot = m_slots[keyOf(provider, episodeLink)];
+    slot.servers = servers;
+    slot.serversExpireAt = now.addSecs(serversTtl);
+    if (expireAt > now) {
+        slot.playInfo = playInfo;
+        slot.playInfoExpireAt = expireAt;
+    } else {
+        slot.playInfo.reset();
+    }
+    evict();
+}
+
+void PlayInfoCache::invalidate(const QString &provider, const QString &episodeLink) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_slots.find(keyOf(provider, episodeLink));
+    if (it != m_slots.end()) it->playInfo.reset();
+}
+
+void PlayInfoCache::evict() {
+    if (m_slots.size() <= maxSlots) return;
+    // Drop the slot whose servers expire first, i.e. the one stored longest ago
+    auto oldest = m_slots.begin();
+    for (auto it = m_slots.begin(); it != m_slots.end(); ++it) {
+        if (it->serversExpireAt < oldest->serversExpireAt) oldest = it;
+    }
+    m_slots.erase(oldest);
+}
+
+QDateTime PlayInfoCache::expiryOf(const QUrl &url) {
+    QDateTime expiry;
+    auto earliest = [&expiry](const QDateTime &time) {
+        if (time.isValid() && (!expiry.isValid() || time < expiry)) expiry = time;
+    };
+
+    // Unix timestamps in seconds or milliseconds, as query items or inside path tokens (hdnts=exp=...~acl=)
+    static const QRegularExpression expiryRegex(
+        R"((?:^|[?&~/;,=])(?:exp|expires|expire|expiry|e|deadline|validto|valid_to)=(\d{10,13})(?!\d))",
+        QRegularExpression::CaseInsensitiveOption);
+    auto matches = expiryRegex.globalMatch(url.toString(QUrl::FullyDecoded));
+    while (matches.hasNext()) {
+        qint64 value = matches.next().captured(1).toLongLong();
+        if (value > 100000000000LL) value /= 1000;
+        earliest(QDateTime::fromSecsSinceEpoch(value, QTimeZone::UTC));
+    }
+
+    // AWS SigV4 presigned URLs carry the signing time and a lifetime instead
+    QUrlQuery query(url);
+    if (query.hasQueryItem("X-Amz-Date") && query.hasQueryItem("X-Amz-Expires")) {
+        auto signedAt = QDateTime::fromString(query.queryItemValue("X-Amz-Date"), "yyyyMMdd'T'HHmmss'Z'");
+        signedAt.setTimeZone(QTimeZone::UTC);
+        earliest(signedAt.addSecs(query.queryItemValue("X-Amz-Expires").toLongLong()));
+    }
+    return expiry;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <optional>
+#include "player/playinfo.h"
+
+// Servers and the resolved sources of recently played episodes, keyed by provider and episode link,
+// so replaying, reloading or going back to an episode skips loadServers and extractSource.
+// Sources expire with their signed URL when it says when, otherwise after the provider's TTL
+class PlayInfoCache {
+public:
+    struct Entry {
+        QList<VideoServer> servers;
+        std::optional<PlayInfo> playInfo;
+    };
+
+    static PlayInfoCache &instance();
+
+    std::optional<Entry> find(const QString &provider, const QString &episodeLink);
+    // When the cached sources stop being served, invalid if there are none
+    QDateTime sourcesExpireAt(const QString &provider, const QString &episodeLink);
+    void storeServers(const QString &provider, const QString &episodeLink, const QList<VideoServer> &servers);
+    void store(const QString &provider, const QString &episodeLink, const QList<VideoServer> &servers,
+               const PlayInfo &playInfo, int ttl);
+    // Drops the sources after a playback error, the server list is kept
+    void invalidate(const QString &provider, const QString &episodeLink);
+
+    // Earliest expiry found in the query or path of a signed URL (exp=, expires=, X-Amz-Expires...)
+    static QDateTime expiryOf(const QUrl &url);
+
+private:
+    PlayInfoCache() = default;
+    PlayInfoCache(const PlayInfoCache&) = delete;
+    PlayInfoCache& operator=(const PlayInfoCache&) = delete;
+
+    struct Slot {
+        QList<VideoServer> servers;
+        QDateTime serversExpireAt;
+        std::optional<PlayInfo> playInfo;
+        QDateTime playInfoExpireAt;
+    };
+    static QString keyOf(const QString &provider, const QString &episodeLink) { return provider + '\n' + episodeLink; }
+    void evict();
+
+    QHash<QString, Slot> m_slots;
+    QMutex m_mutex;
+
+    inline static constexpr int serversTtl = 30 * 60;
+    inline static constexpr int expiryMargin = 60; // Seconds before a signed URL expires that it stops being used
+    inline static constexpr int maxSlots = 64;
+};
@@ -3,9 +3,18 @@
 #include "player/mpvObject.h"
 #include "utils/errorhandler.h"
 #include "providers/showprovider.h"
+#include "player/playinfocache.h"
 
 PlaylistManager::PlaylistManager(QObject *parent) : QAbstractItemModel(parent)
 {
+    // Time to play suffers most from single stalled mirror connections, so race a second copy of slow requests
+    Client::RetryPolicy retryPolicy;
+    retryPolicy.hedge = true;
+    m_client.setRetryPolicy(retryPolicy);
+
+    m_prefetchPool.setMaxThreadCount(1);
+    m_prefetchPool.setThreadPriority(QThread::LowPriority);
+
     // Opens the file to play immediately when application launches
 
     connect (&m_folderWatcher, &QFileSystemWatcher::directoryChanged, this, &PlaylistManager::onLocalDirectoryChanged);
@@ -16,6 +25,7 @@ PlaylistManager::PlaylistManager(QObject *parent) : QAbstractItemModel(parent)
                 auto playInfo = m_watcher.result();
                 if (playInfo.sources.isEmpty()) return;
                 MpvObject::instance()->open(playInfo.sources.first(), m_currentLoadingEpisode->timeStamp);
+                connect(MpvObject::instance(), &MpvObject::timeChanged, this, &PlaylistManager::onTimeChanged, Qt::UniqueConnection);
                 emit aboutToPlay();
             } catch (MyException& ex) {
                 ErrorHandler::instance().show (ex.what(), "Playlist MyError");
@@ -53,6 +63,8 @@ bool PlaylistManager::tryPlay(int playlistIndex, int itemIndex) {
     if (episodeToLoad == m_currentLoadingEpisode) {
         qDebug() << "same episode!";
     }
+    // A prefetch of another episode is no longer useful, one of this episode is awaited in play()
+    if (m_prefetchLink != episodeToLoad->link) cancelPrefetch();
 
     m_isCancelled = false;
     setIsLoading(true);
@@ -94,6 +106,7 @@ PlayInfo PlaylistManager::play(int playlistIndex, int itemIndex) {
         }
         m_subtitleListModel.clear();
         playInfo.sources.emplaceBack (episode->link);
+        setPlaying({});
 
     } else {
         ShowProvider *provider = playlist->getProvider();
@@ -105,20 +118,16 @@ PlayInfo PlaylistManager::play(int playlistIndex, int itemIndex) {
         qInfo().noquote() << QString("Log (Playlist)   : Fetching servers for %1 [%2/%3]")
                                  .arg (episode->getFullName().trimmed()).arg (itemIndex + 1).arg (playlist->size());
 
-        QList<VideoServer> servers = provider->loadServers(&m_client, episode);
-        if (m_isCancelled) return {};
-        if (servers.isEmpty()) {
-            throw MyException("No servers found for " + episode->getFullName().trimmed());
-        }
-
-        qInfo().noquote() << "Log (Playlist)   : Successfully fetched servers for " << episode->getFullName().trimmed();
+        // Whatever the prefetch has not finished yet is quicker to wait for than to start over
+        if (m_prefetchLink == episode->link) m_prefetchFuture.waitForFinished();
 
-        if (m_isCancelled) return {};
-        playInfo = ServerListModel::autoSelectServer(&m_client, servers, provider);
+        QList<VideoServer> servers;
+        playInfo = resolve(&m_client, provider, episode, servers);
         if (m_isCancelled) return {};
         if (!playInfo.sources.isEmpty()) {
             m_serverListModel.setServers(servers, provider);
             m_serverListModel.setCurrentIndex(playInfo.serverIndex);
+            setPlaying({provider->name(), servers.at(playInfo.serverIndex).name, episode->link});
             m_subtitleListModel.setList(playInfo.subtitles);
         } else {
             throw MyException("No sources extracted from " + episode->getFullName().trimmed());
@@ -136,6 +145,92 @@ PlayInfo PlaylistManager::play(int playlistIndex, int itemIndex) {
     return playInfo;
 }
 
+PlayInfo PlaylistManager::resolve(Client *client, ShowProvider *provider, const PlaylistItem *episode, QList<VideoServer> &servers,
+                                  bool refresh) {
+    auto &cache = PlayInfoCache::instance();
+    auto cached = cache.find(provider->name(), episode->link);
+    if (cached && cached->playInfo && !refresh) {
+        qInfo().noquote() << "Log (Playlist)   : Using cached sources for" << episode->getFullName().trimmed();
+        servers = cached->servers;
+        return *cached->playInfo;
+    }
+
+    if (cached) {
+        servers = cached->servers;
+    } else {
+        servers = provider->loadServers(client, episode);
+        if (client->isCancelled()) return {};
+        if (servers.isEmpty()) {
+            throw MyException("No servers found for " + episode->getFullName().trimmed());
+        }
+        qInfo().noquote() << "Log (Playlist)   : Successfully fetched servers for " << episode->getFullName().trimmed();
+        cache.storeServers(provider->name(), episode->link, servers);
+    }
+
+    if (client->isCancelled()) return {};
+    PlayInfo playInfo = ServerListModel::autoSelectServer(client, servers, provider);
+    if (client->isCancelled()) return {};
+    if (!playInfo.sources.isEmpty())
+        cache.store(provider->name(), episode->link, servers, playInfo, provider->getPlayInfoTtl());
+    return playInfo;
+}
+
+void PlaylistManager::onTimeChanged() {
+    auto mpv = MpvObject::instance();
+    if (m_prefetchThreshold <= 0 || mpv->duration() <= 0) return;
+    if (mpv->time() < m_prefetchThreshold * mpv->duration()) return;
+    prefetchNext(mpv->duration() - mpv->time());
+}
+
+void PlaylistManager::prefetchNext(qint64 remaining) {
+    auto playlist = m_root->getCurrentItem();
+    if (!playlist || m_watcher.isRunning() || m_prefetchFuture.isRunning()) return;
+    auto next = playlist->at(playlist->currentIndex + 1);
+    auto provider = playlist->getProvider();
+    if (!next || !provider || next->type != PlaylistItem::ONLINE) return;
+
+    auto now = QDateTime::currentDateTimeUtc();
+    // Failed or just refreshed, the time ticks every second so this keeps it to one attempt a minute
+    if (next->link == m_prefetchLink && m_lastPrefetchAt.isValid() && m_lastPrefetchAt.secsTo(now) < 60) return;
+    bool refresh = false;
+    auto expireAt = PlayInfoCache::instance().sourcesExpireAt(provider->name(), next->link);
+    if (expireAt.isValid()) {
+        // Still usable when this episode ends
+        if (expireAt > now.addSecs(remaining + 30)) return;
+        // Short lived signatures are renewed just before they lapse, renewing now would lapse again too early
+        if (now.secsTo(expireAt) > 90) return;
+        refresh = true;
+    }
+
+    cancelPrefetch();
+    m_lastPrefetchAt = now;
+    auto isCancelled = std::make_shared<std::atomic<bool>>(false);
+    m_prefetchCancelled = isCancelled;
+    m_prefetchLink = next->link;
+    qInfo().noquote() << "Log (Playlist)   :" << (refresh ? "Refreshing" : "Prefetching") << "sources for" << next->getFullName().trimmed();
+    // The playlist holds the episode, keep it alive until the prefetch is done with it
+    playlist->use();
+    m_prefetchFuture = QtConcurrent::run(&m_prefetchPool, [isCancelled, provider, next, refresh]() {
+        if (*isCancelled) return;
+        try {
+            Client client(isCancelled.get());
+            QList<VideoServer> servers;
+            resolve(&client, provider, next, servers, refresh);
+        } catch (const std::exception &ex) {
+            if (!*isCancelled)
+                qDebug() << "Log (Playlist)   : Prefetch failed:" << ex.what();
+        } catch (...) {}
+    }).then(this, [playlist]() {
+        playlist->disuse();
+    });
+}
+
+void PlaylistManager::cancelPrefetch() {
+    if (m_prefetchCancelled) *m_prefetchCancelled = true;
+    m_prefetchCancelled.reset();
+    m_prefetchLink.clear();
+}
+
 void PlaylistManager::loadIndex(QModelIndex index) {
     auto childItem = static_cast<PlaylistItem *>(index.internalPointer());
     auto parentItem = childItem->parent();
@@ -348,9 +443,24 @@ void PlaylistManager::reload() {
     if (!currentPlaylist) return;
     auto time = MpvObject::instance()->time();
     currentPlaylist->setLastPlayAt(currentPlaylist->currentIndex, time);
+    // A manual reload means the source looked broken even if mpv did not report it, extract it again
+    auto episode = currentPlaylist->getCurrentItem();
+    if (auto provider = currentPlaylist->getProvider(); provider && episode)
+        PlayInfoCache::instance().invalidate(provider->name(), episode->link);
     tryPlay();
 }
 
+void PlaylistManager::reportPlaybackError() {
+    m_playingMutex.lock();
+    const PlayingSource playing = m_playing;
+    m_playingMutex.unlock();
+    if (playing.provider.isEmpty()) return;
+    qInfo() << "Log (Playlist)   : Playback failed on server" << playing.server;
+    ServerScoreboard::instance().recordPlaybackFailure(playing.provider, playing.server);
+    // The source may have expired or been revoked, the next attempt extracts it again
+    PlayInfoCache::instance().invalidate(playing.provider, playing.episodeLink);
+}
+
 void PlaylistManager::setIsLoading(bool value) {
     m_isLoading = value;
     emit isLoadingChanged();
@@ -372,6 +482,11 @@ void PlaylistManager::loadServer(int index) {
             m_serverListModel.setCurrentIndex(index);
             auto serverName = m_serverListModel.getServerAt(index).name;
             currentPlaylist->getProvider()->setPreferredServer(serverName);
+            auto episodeLink = currentPlaylist->getCurrentItem()->link;
+            auto providerName = currentPlaylist->getProvider()->name();
+            setPlaying({providerName, serverName, episodeLink});
+            PlayInfoCache::instance().store(providerName, episodeLink, m_serverListModel.getServers(),
+                                            playInfo, currentPlaylist->getProvider()->getPlayInfoTtl());
             qInfo() << "Log (Server): Fetched source" << playInfo.sources.first().videoUrl;
             if (m_isCancelled) return;
             MpvObject::instance()->open (playInfo.sources.first(), MpvObject::instance()->time());
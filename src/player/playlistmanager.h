@@ -1,5 +1,6 @@
 #pragma once
 #include <QDir>
+#include <QMutex>
 #include <QStandardItemModel>
 #include <QtConcurrent>
 #include "core/showdata.h"
@@ -14,6 +15,7 @@ class PlaylistManager : public QAbstractItemModel {
     Q_PROPERTY(ServerListModel *serverList READ getServerList CONSTANT)
     Q_PROPERTY(SubtitleListModel *subtitleList READ getSubtitleList CONSTANT)
     Q_PROPERTY(bool isLoading READ isLoading NOTIFY isLoadingChanged)
+    Q_PROPERTY(float prefetchThreshold READ getPrefetchThreshold WRITE setPrefetchThreshold NOTIFY prefetchThresholdChanged)
 
 private:
     bool m_isLoading = false;
@@ -25,6 +27,39 @@ private:
     QFileSystemWatcher m_folderWatcher;
     QFutureWatcher<PlayInfo> m_watcher;
     ServerListModel m_serverListModel;
+    // What is being played, blamed on the scoreboard and dropped from the cache if playback fails
+    struct PlayingSource {
+        QString provider;
+        QString server;
+        QString episodeLink;
+    };
+    // Written by the play and server workers, read on the GUI thread when playback fails
+    PlayingSource m_playing;
+    QMutex m_playingMutex;
+    void setPlaying(const PlayingSource &source) {
+        QMutexLocker locker(&m_playingMutex);
+        m_playing = source;
+    }
+
+    // The next episode is resolved into the PlayInfoCache once this fraction of the current one has played,
+    // on a single low priority thread so it never competes with what is playing now. 0 disables it
+    float m_prefetchThreshold = 0.5;
+    float getPrefetchThreshold() const { return m_prefetchThreshold; }
+    void setPrefetchThreshold(float threshold) {
+        if (qFuzzyCompare(threshold, m_prefetchThreshold)) return;
+        m_prefetchThreshold = threshold;
+        emit prefetchThresholdChanged();
+    }
+    QThreadPool m_prefetchPool;
+    // Fresh per prefetch so cancelling one never leaks into the next queued behind it
+    std::shared_ptr<std::atomic<bool>> m_prefetchCancelled;
+    QFuture<void> m_prefetchFuture;
+    QString m_prefetchLink;
+    QDateTime m_lastPrefetchAt;
+    Q_SLOT void onTimeChanged();
+    // remaining is what is left of the current episode in seconds, the prefetched sources must outlive it
+    void prefetchNext(qint64 remaining);
+    void cancelPrefetch();
     SubtitleListModel m_subtitleListModel;
 
 
@@ -41,12 +76,18 @@ private:
     void unregisterPlaylist(PlaylistItem *playlist);
 
     PlayInfo play(int playlistIndex, int itemIndex);
+    // Servers and a working source for an episode, from the PlayInfoCache when still valid
+    // refresh extracts again even if cached sources are still valid, keeping the cached server list
+    static PlayInfo resolve(Client *client, ShowProvider *provider, const PlaylistItem *episode, QList<VideoServer> &servers,
+                            bool refresh = false);
     Q_SLOT void onLocalDirectoryChanged(const QString &path);
     QStringList m_subtitleExtensions = { "srt", "sub", "ssa", "ass", "idx", "vtt" };
     void setSubtitle(const QUrl &url);
 public:
     explicit PlaylistManager(QObject *parent = nullptr);
     ~PlaylistManager() {
+        cancelPrefetch();
+        m_prefetchPool.waitForDone();
         //m_root->clear();
         delete m_root;
     }
@@ -70,6 +111,7 @@ public:
     Q_INVOKABLE void loadIndex(QModelIndex index);
     Q_INVOKABLE void loadServer(int index);
     Q_INVOKABLE void reload();
+    Q_INVOKABLE void reportPlaybackError();
 
     QModelIndex getCurrentListIndex() {
         return createIndex(m_root->currentIndex, 0, m_root->getCurrentItem());
@@ -91,6 +133,7 @@ public:
     Q_SIGNAL void isLoadingChanged(void);
     Q_SIGNAL void currentIndexChanged(void);
     Q_SIGNAL void aboutToPlay(void);
+    Q_SIGNAL void prefetchThresholdChanged(void);
 
 
 private:
@@ -1,4 +1,139 @@
 #include "serverlistmodel.h"
 #include "providers/showprovider.h"
+#include <QDeadlineTimer>
+#include <QWaitCondition>
 
+namespace {
+QThreadPool *racePool() {
+    // Kept apart from the global pool so racing never waits behind explorer or download work
+    static QThreadPool *pool = [] {
+        static QThreadPool instance;
+        instance.setMaxThreadCount(6);
+        return &instance;
+    }();
+    return pool;
+}
+}
 
+PlayInfo ServerListModel::raceServers(Client *client, QList<VideoServer> &servers, ShowProvider *provider,
+                                      const QString &preferredServer, int width) {
+    width = std::max(1, width);
+    struct Racer {
+        enum State { Running, Succeeded, Failed };
+        Racer(int serverIndex, const Client &parent) : serverIndex(serverIndex), client(parent) {
+            client.setShouldCancel(&isCancelled);
+        }
+        int serverIndex;
+        std::atomic<bool> isCancelled = false;
+        Client client;
+        State state = Running;
+        PlayInfo playInfo;
+    };
+    struct Race {
+        QMutex mutex;
+        QWaitCondition changed;
+    };
+    auto race = std::make_shared<Race>();
+    QList<std::shared_ptr<Racer>> racers; // In preference order
+
+    int preferredIndex = -1;
+    QList<int> order;
+    for (int i = 0; i < servers.size(); ++i) {
+        if (preferredIndex < 0 && !preferredServer.isEmpty() && servers[i].name == preferredServer)
+            preferredIndex = i;
+        else
+            order.append(i);
+    }
+    if (preferredIndex >= 0) order.prepend(preferredIndex);
+
+    auto launch = [&](int serverIndex) {
+        auto racer = std::make_shared<Racer>(serverIndex, *client);
+        racers.append(racer);
+        racePool()->start([race, racer, provider, server = servers.at(serverIndex)]() {
+            PlayInfo playInfo;
+            try {
+                if (!racer->isCancelled)
+                    playInfo = extractAndCheck(&racer->client, provider, server);
+            } catch (const std::exception &ex) {
+                if (!racer->isCancelled)
+                    qDebug() << "Log (Servers)    : Server" << server.name << "failed:" << ex.what();
+            } catch (...) {}
+            QMutexLocker locker(&race->mutex);
+            racer->state = playInfo.sources.isEmpty() ? Racer::Failed : Racer::Succeeded;
+            racer->playInfo = std::move(playInfo);
+            race->changed.wakeAll();
+        });
+    };
+
+    QMutexLocker locker(&race->mutex);
+    int next = 0;
+    if (preferredIndex >= 0) {
+        launch(order[next++]);
+        QDeadlineTimer headStart(s_headStart);
+        while (racers.first()->state == Racer::Running && !headStart.hasExpired() && !client->isCancelled())
+            race->changed.wait(&race->mutex, QDeadlineTimer(std::min<qint64>(headStart.remainingTime(), s_cancelCheck)));
+    }
+
+    int winner = -1;
+    QDeadlineTimer grace(QDeadlineTimer::Forever);
+    while (!client->isCancelled()) {
+        int running = 0;
+        int best = -1;
+        bool betterRunning = false;
+        for (int i = 0; i < racers.size(); ++i) {
+            if (racers[i]->state == Racer::Running) {
+                running++;
+                if (best < 0) betterRunning = true;
+            } else if (racers[i]->state == Racer::Succeeded && best < 0) {
+                best = i;
+            }
+        }
+        if (best >= 0) {
+            if (grace.isForever()) grace.setRemainingTime(s_grace);
+            if (!betterRunning || grace.hasExpired()) {
+                winner = best;
+                break;
+            }
+        } else {
+            for (; running < width && next < order.size(); running++) launch(order[next++]);
+            // Every server has been tried and none works
+            if (running == 0) break;
+        }
+        // Sleeps until a racer reports or the grace period ends
+        qint64 waitFor = best >= 0 ? std::clamp<qint64>(grace.remainingTime(), 1, s_cancelCheck) : s_cancelCheck;
+        race->changed.wait(&race->mutex, QDeadlineTimer(waitFor));
+    }
+
+    for (const auto &racer : std::as_const(racers)) {
+        if (racer->state == Racer::Running) racer->isCancelled = true;
+    }
+    if (client->isCancelled()) return PlayInfo();
+
+    PlayInfo playInfo;
+    QString winnerName;
+    int winnerIndex = -1;
+    if (winner >= 0) {
+        playInfo = racers[winner]->playInfo;
+        winnerIndex = racers[winner]->serverIndex;
+        winnerName = servers[winnerIndex].name;
+    }
+
+    // Only servers that finished without a working source are dropped, cancelled ones are not known broken
+    QList<int> broken;
+    for (const auto &racer : std::as_const(racers)) {
+        if (racer->state == Racer::Failed) broken.append(racer->serverIndex);
+    }
+    std::sort(broken.begin(), broken.end(), std::greater<int>());
+    for (int index : broken) {
+        qDebug() << "Log (Servers)    : Server" << servers[index].name << "is broken";
+        servers.removeAt(index);
+        if (index < winnerIndex) winnerIndex--;
+    }
+
+    if (winner >= 0) {
+        playInfo.serverIndex = winnerIndex;
+        if (winnerName != preferredServer) provider->setPreferredServer(winnerName);
+        qDebug() << "Log (Servers)    : Using server" << winnerName;
+    }
+    return playInfo;
+}
@@ -4,7 +4,9 @@
 
 // #include "serverlist.h"
 #include "providers/showprovider.h"
+#include "player/serverscoreboard.h"
 #include <QAbstractListModel>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
 #include <QPair>
 #include <QtConcurrent>
@@ -68,59 +70,75 @@ public:
     }
 
     static void checkSources(Client *client, QList<Video> &sources) {
-        QMutableListIterator<Video> sourceIterator(sources);
-        while (sourceIterator.hasNext()) {
-            auto video = sourceIterator.next();
-            if (!client->isOk(video.videoUrl.toString(), video.getHeaders()))
-                sourceIterator.remove();
+        // Every probe is in flight before the first result is awaited, so the wait is one round trip
+        QList<QFuture<bool>> checks;
+        checks.reserve(sources.size());
+        for (const auto &video : std::as_const(sources)) {
+            checks.append(client->isOkAsync(video.videoUrl.toString(), video.getHeaders()));
+        }
+        for (qsizetype i = sources.size() - 1; i >= 0; --i) {
+            if (!checks[i].result())
+                sources.removeAt(i);
         }
     }
 
-    static PlayInfo autoSelectServer(Client* client, QList<VideoServer> &servers, ShowProvider *provider,const QString &preferredServerName = "") {
+    // Picks the working server expected to start fastest, probing up to raceWidth servers at once.
+    // Background callers such as downloads pass 1 so they probe one server at a time
+    static PlayInfo autoSelectServer(Client* client, QList<VideoServer> &servers, ShowProvider *provider,
+                                     const QString &preferredServerName = "", int raceWidth = s_raceWidth) {
         QString preferredServer = preferredServerName.isEmpty() ? provider->getPreferredServer() : preferredServerName;
-        PlayInfo playInfo;
-        if (!preferredServer.isEmpty()) {
-            QMutableListIterator<VideoServer> serverIterator(servers);
-            int index = -1;
-            while (serverIterator.hasNext()) {
-                auto &server = serverIterator.next();
-                index++;
-                if (server.name != preferredServer) continue;
-                playInfo = provider->extractSource(client, server);
-                checkSources(client, playInfo.sources);
-                if (!playInfo.sources.isEmpty()){
-                    playInfo.serverIndex = index;
-                    qDebug() << "Log (Servers)    : Using preferred server" << server.name;
-                    return playInfo;
-                } else {
-                    qDebug() << "Log (Servers)    : Preferred server" << preferredServer << "is broken";
-                    serverIterator.remove();
-                }
-            }
+        auto &scoreboard = ServerScoreboard::instance();
+        int untripped = scoreboard.sort(servers, provider->name(), preferredServer);
+        // A preferred server that keeps failing loses its priority until it recovers
+        if (scoreboard.isTripped(provider->name(), preferredServer))
+            preferredServer.clear();
+        // Servers whose circuit is open sit out until their cooldown expires, unless no other one works.
+        // They stay listed after the others so they can still be picked by hand
+        QList<VideoServer> tripped;
+        if (untripped > 0) {
+            tripped = servers.mid(untripped);
+            servers.resize(untripped);
         }
-
-
-        QMutableListIterator<VideoServer> serverIterator(servers);
-        int index = -1;
-        while (serverIterator.hasNext()) {
-            auto &server = serverIterator.next();
-            index++;
+        PlayInfo playInfo = raceServers(client, servers, provider, preferredServer, raceWidth);
+        if (playInfo.sources.isEmpty() && !tripped.isEmpty() && !client->isCancelled()) {
+            qDebug() << "Log (Servers)    : No healthy server works, trying the tripped ones";
+            playInfo = raceServers(client, tripped, provider, "", raceWidth);
+            if (!playInfo.sources.isEmpty()) playInfo.serverIndex += servers.size();
+        }
+        servers.append(tripped);
+        return playInfo;
+    }
+    // Extracts the server and drops its dead sources, recording how it went on the scoreboard
+    static PlayInfo extractAndCheck(Client *client, ShowProvider *provider, const VideoServer &server) {
+        QElapsedTimer timer;
+        timer.start();
+        PlayInfo playInfo;
+        try {
             playInfo = provider->extractSource(client, server);
             checkSources(client, playInfo.sources);
-            if (!playInfo.sources.isEmpty()){
-                provider->setPreferredServer(server.name);
-                playInfo.serverIndex = index;
-                qDebug() << "Log (Servers)    : Using server" << server.name;
-                break;
-            } else {
-                qDebug() << "Log (Servers)    : Server" << server.name << "is broken";
-                serverIterator.remove();
-            }
-
+        } catch (...) {
+            if (!client->isCancelled())
+                ServerScoreboard::instance().recordFailure(provider->name(), server.name);
+            throw;
         }
-
+        if (client->isCancelled()) return playInfo;
+        if (playInfo.sources.isEmpty())
+            ServerScoreboard::instance().recordFailure(provider->name(), server.name);
+        else
+            ServerScoreboard::instance().recordSuccess(provider->name(), server.name, timer.elapsed());
         return playInfo;
     }
+    // Extracts and checks up to width servers at once on a dedicated pool. The preferred server
+    // runs alone for s_headStart ms first, and once any server works the better ranked ones still
+    // running get s_grace ms to finish before the best working one is taken and the rest cancelled
+    static PlayInfo raceServers(Client* client, QList<VideoServer> &servers, ShowProvider *provider,
+                                const QString &preferredServer, int width);
+    inline static int s_raceWidth = 3;
+    inline static int s_headStart = 400;
+    inline static int s_grace = 300;
+    // Every result wakes the race at once, but the caller's cancellation flag cannot signal it and is checked this often
+    inline static int s_cancelCheck = 250;
+
     VideoServer &getServerAt(int index) {
         if (!isValidIndex(index))
             throw std::out_of_range("Index out of range");
@@ -135,6 +153,7 @@ public:
     }
 
     int getCurrentIndex() const { return m_currentIndex; }
+    const QList<VideoServer> &getServers() const { return m_servers; }
     // ServerList& getServerList() { return m_serverList; }
     PlayInfo extract(Client* client, int index) {
         PlayInfo playInfo;
@@ -142,8 +161,9 @@ public:
         if (isValidIndex(index)) {
             serverName = m_servers.at(index).name;
             qInfo() << "Log (Servers)    : Attempting to extract source from server" << serverName;
-            playInfo = m_provider->extractSource(client, m_servers.at(index));
+            playInfo = extractAndCheck(client, m_provider, m_servers.at(index));
             playInfo.serverIndex = index;
+            return playInfo;
         } else {
             // Auto select server
             playInfo = autoSelectServer(client, m_servers, m_provider, "");
@@ -0,0 +1,165 @@
+#include "serverscoreboard.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimeZone>
+#include <algorithm>
+
+ServerScoreboard &ServerScoreboard::instance() {
+    static ServerScoreboard scoreboard;
+    return scoreboard;
+}
+
+ServerScoreboard::ServerScoreboard()
+    : m_path(QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QDir::separator() + "servers.json")) {
+    load();
+}
+
+void ServerScoreboard::recordSuccess(const QString &provider, const QString &server, qint64 msecs) {
+    recordOutcome(provider, server, true, 1, msecs);
+}
+
+void ServerScoreboard::recordFailure(const QString &provider, const QString &server) {
+    recordOutcome(provider, server, false, 1);
+}
+
+void ServerScoreboard::recordPlaybackFailure(const QString &provider, const QString &server) {
+    recordOutcome(provider, server, false, 2);
+}
+
+void ServerScoreboard::recordOutcome(const QString &provider, const QString &server, bool success, double weight, qint64 msecs) {
+    QMutexLocker locker(&m_mutex);
+    auto &score = m_scores[keyOf(provider, server)];
+    if (success)
+        score.latency = score.latency == 0 ? msecs : alpha * msecs + (1 - alpha) * score.latency;
+    double a = std::min(1.0, alpha * weight);
+    score.successRate = a * (success ? 1 : 0) + (1 - a) * score.successRate;
+    if (success) {
+        score.consecutiveFailures = 0;
+        score.trippedUntil = QDateTime();
+    } else if (++score.consecutiveFailures >= tripAfter) {
+        // Every further failure while half open doubles the time the server is left alone
+        int secs = std::min(maxTripSecs, baseTripSecs << std::min(score.consecutiveFailures - tripAfter, 6));
+        score.trippedUntil = QDateTime::currentDateTimeUtc().addSecs(secs);
+        qDebug() << "Log (Servers)    : Skipping" << server << "on" << provider << "for" << secs / 60 << "minutes";
+    }
+    m_isDirty = true;
+    // Scores change a few times per episode so a minute between writes is plenty
+    if (m_lastSave.isValid() && m_lastSave.secsTo(QDateTime::currentDateTimeUtc()) < 60) return;
+    quint64 generation = 0;
+    auto scores = snapshot(&generation);
+    locker.unlock();
+    write(scores, generation);
+}
+
+double ServerScoreboard::expectedTtfb(const Score &score) const {
+    double latency = score.latency == 0 ? defaultLatency : score.latency;
+    return latency / std::max(score.successRate, 0.05);
+}
+
+bool ServerScoreboard::isTripped(const Score &score) const {
+    return score.trippedUntil.isValid() && score.trippedUntil > QDateTime::currentDateTimeUtc();
+}
+
+double ServerScoreboard::expectedTtfb(const QString &provider, const QString &server) const {
+    QMutexLocker locker(&m_mutex);
+    return expectedTtfb(m_scores.value(keyOf(provider, server)));
+}
+
+bool ServerScoreboard::isTripped(const QString &provider, const QString &server) const {
+    QMutexLocker locker(&m_mutex);
+    return isTripped(m_scores.value(keyOf(provider, server)));
+}
+
+int ServerScoreboard::sort(QList<VideoServer> &servers, const QString &provider, const QString &preferredServer) const {
+    struct Rank {
+        bool isTripped;
+        bool isPreferred;
+        double ttfb;
+    };
+    QHash<QString, Rank> ranks;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const auto &server : std::as_const(servers)) {
+            auto score = m_scores.value(keyOf(provider, server.name));
+            ranks.insert(server.name, {isTripped(score), server.name == preferredServer, expectedTtfb(score)});
+        }
+    }
+    std::stable_sort(servers.begin(), servers.end(), [&ranks](const VideoServer &a, const VideoServer &b) {
+        const auto &ra = ranks[a.name];
+        const auto &rb = ranks[b.name];
+        if (ra.isTripped != rb.isTripped) return rb.isTripped;
+        if (ra.isPreferred != rb.isPreferred) return ra.isPreferred;
+        return ra.ttfb < rb.ttfb;
+    });
+    auto untripped = std::find_if(servers.cbegin(), servers.cend(), [&ranks](const VideoServer &server) {
+        return ranks[server.name].isTripped;
+    });
+    return static_cast<int>(untripped - servers.cbegin());
+}
+
+void ServerScoreboard::load() {
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    auto scores = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = scores.begin(); it != scores.end(); ++it) {
+        auto object = it.value().toObject();
+        Score score;
+        score.latency = object["latency"].toDouble();
+        score.successRate = object["successRate"].toDouble(0.8);
+        score.consecutiveFailures = object["consecutiveFailures"].toInt();
+        if (object.contains("trippedUntil"))
+            score.trippedUntil = QDateTime::fromSecsSinceEpoch(object["trippedUntil"].toInteger(), QTimeZone::UTC);
+        m_scores.insert(it.key(), score);
+    }
+    m_lastSave = QDateTime::currentDateTimeUtc();
+}
+
+QHash<QString, ServerScoreboard::Score> ServerScoreboard::snapshot(quint64 *generation) {
+    m_lastSave = QDateTime::currentDateTimeUtc();
+    m_isDirty = false;
+    *generation = ++m_generation;
+    return m_scores;  // Implicitly shared, the copy happens when the next outcome is recorded
+}
+
+void ServerScoreboard::write(const QHash<QString, Score> &snapshot, quint64 generation) {
+    QMutexLocker locker(&m_fileMutex);
+    // Racing writers may finish out of order, an older snapshot must not overwrite a newer one
+    if (generation <= m_writtenGeneration) return;
+    QJsonObject scores;
+    for (auto it = snapshot.cbegin(); it != snapshot.cend(); ++it) {
+        QJsonObject object;
+        object["latency"] = it->latency;
+        object["successRate"] = it->successRate;
+        object["consecutiveFailures"] = it->consecutiveFailures;
+        if (it->trippedUntil.isValid())
+            object["trippedUntil"] = it->trippedUntil.toSecsSinceEpoch();
+        scores[it.key()] = object;
+    }
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(scores).toJson(QJsonDocument::Compact));
+        if (file.commit()) {
+            m_writtenGeneration = generation;
+            return;
+        }
+    }
+    qWarning() << "Log (Servers)    : Failed to save" << m_path;
+    locker.unlock();
+    QMutexLocker scoresLocker(&m_mutex);
+    m_isDirty = true;  // Written again with the next snapshot
+}
+
+void ServerScoreboard::save() {
+    QMutexLocker locker(&m_mutex);
+    if (!m_isDirty) return;
+    quint64 generation = 0;
+    auto scores = snapshot(&generation);
+    locker.unlock();
+    write(scores, generation);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include "player/playinfo.h"
+
+class ShowProvider;
+
+// Remembers how each provider's servers behaved, across sessions, so server selection can try the
+// ones expected to start fastest first and skip those that keep failing (a simple circuit breaker)
+class ServerScoreboard {
+public:
+    static ServerScoreboard &instance();
+
+    void recordSuccess(const QString &provider, const QString &server, qint64 msecs);
+    void recordFailure(const QString &provider, const QString &server);
+    // The source played but broke mid-playback, weighs more than a failed extraction
+    void recordPlaybackFailure(const QString &provider, const QString &server);
+
+    // Milliseconds until the first byte plays, counting the retries a flaky server costs on average
+    double expectedTtfb(const QString &provider, const QString &server) const;
+    bool isTripped(const QString &provider, const QString &server) const;
+
+    // Orders servers by expected time to first byte. The preferred server stays first while healthy and
+    // tripped servers go last. Returns how many servers lead the list untripped, only those should be tried
+    // until their cooldown expires, unless that is none of them
+    int sort(QList<VideoServer> &servers, const QString &provider, const QString &preferredServer) const;
+
+    void save();
+
+private:
+    ServerScoreboard();
+    ServerScoreboard(const ServerScoreboard&) = delete;
+    ServerScoreboard& operator=(const ServerScoreboard&) = delete;
+
+    struct Score {
+        double latency = 0;       // EWMA of successful extraction and validation time in ms
+        double successRate = 0.8; // EWMA of outcomes, starts optimistic for unseen servers
+        int consecutiveFailures = 0;
+        QDateTime trippedUntil;
+    };
+    static QString keyOf(const QString &provider, const QString &server) { return provider + '/' + server; }
+    void recordOutcome(const QString &provider, const QString &server, bool success, double weight, qint64 msecs = 0);
+    double expectedTtfb(const Score &score) const;
+    bool isTripped(const Score &score) const;
+    void load();
+    // Called with m_mutex held, takes a copy of the scores to write once the lock is released
+    QHash<QString, Score> snapshot(quint64 *generation);
+    // Writes a snapshot without holding m_mutex, so recording an outcome never waits on the disk
+    void write(const QHash<QString, Score> &scores, quint64 generation);
+
+    QHash<QString, Score> m_scores;
+    mutable QMutex m_mutex;
+    const QString m_path;
+    QDateTime m_lastSave;
+    bool m_isDirty = false;
+    quint64 m_generation = 0;  // Snapshots taken, guarded by m_mutex
+    QMutex m_fileMutex;
+    quint64 m_writtenGeneration = 0;  // Newest snapshot on disk, guarded by m_fileMutex
+
+    inline static constexpr double alpha = 0.3;
+    inline static constexpr double defaultLatency = 3000;
+    inline static constexpr int tripAfter = 3;
+    inline static constexpr int baseTripSecs = 10 * 60;
+    inline static constexpr int maxTripSecs = 6 * 60 * 60;
+};
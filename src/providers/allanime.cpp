@@ -7,9 +7,7 @@ QList<ShowData> AllAnime::search(Client *client, const QString &query, int page,
                   + QString::number(page)
                   + ",\"translationType\":\"sub\",\"countryOrigin\":\"ALL\"}&extensions={\"persistedQuery\":{\"version\":1,\"sha256Hash\":\"06327bc10dd682e1ee7e07b6db9c16e9ad2fd56c1b769e47513128cd5c9fc77a\"}}";
 
-    auto data = client->get(url, headers).toJsonObject()["data"].toObject();
-    QJsonArray showsJsonArray = data["shows"].toObject()["edges"].toArray();
-    return parseJsonArray(showsJsonArray);
+    return parseShows(client->get(url, headers).json().all("data.shows.edges[*]"));
 }
 
 QList<ShowData> AllAnime::popular(Client *client, int page, int type) {
@@ -18,9 +16,7 @@ QList<ShowData> AllAnime::popular(Client *client, int page, int type) {
                   + QString::number(page)
                   + ",%22allowAdult%22:true,%22allowUnknown%22:false}&extensions={%22persistedQuery%22:{%22version%22:1,%22sha256Hash%22:%221fc9651b0d4c3b9dfd2fa6e1d50b8f4d11ce37f988c23b8ee20f82159f7c1147%22}}";
 
-    QJsonObject jsonResponse = client->get(url, headers).toJsonObject();
-    QJsonArray showJsonArray = jsonResponse["data"].toObject()["queryPopular"].toObject()["recommendations"].toArray();
-    return parseJsonArray(showJsonArray, true);
+    return parseShows(client->get(url, headers).json().all("data.queryPopular.recommendations[*].anyCard"));
 }
 
 QList<ShowData> AllAnime::latest(Client *client, int page, int type) {
@@ -28,45 +24,41 @@ QList<ShowData> AllAnime::latest(Client *client, int page, int type) {
                   + QString::number(page)
                   +",%22translationType%22:%22sub%22,%22countryOrigin%22:%22JP%22}&extensions={%22persistedQuery%22:{%22version%22:1,%22sha256Hash%22:%2206327bc10dd682e1ee7e07b6db9c16e9ad2fd56c1b769e47513128cd5c9fc77a%22}}";
 
-
-    auto data = client->get(url, headers).toJsonObject()["data"].toObject();
-    auto showsJsonArray = data["shows"].toObject()["edges"].toArray();
-    return parseJsonArray(showsJsonArray);
+    return parseShows(client->get(url, headers).json().all("data.shows.edges[*]"));
 }
 
 int AllAnime::loadDetails(Client *client, ShowData &show, bool loadInfo, bool getPlaylist, bool getEpisodeCount) const {
     QString url = "https://api.allanime.day/api?variables={%22_id%22:%22"
                   + show.link
                   +"%22}&extensions={%22persistedQuery%22:{%22version%22:1,%22sha256Hash%22:%229d7439c90f203e534ca778c4901f9aa2d3ad42c06243ab2c5e6b79612af32028%22}}";
-    auto jsonResponse = client->get(url, headers).toJsonObject()["data"].toObject()["show"].toObject();
+    auto jsonResponse = client->get(url, headers).json().at("data.show");
 
-    if (jsonResponse.isEmpty()) return false;
+    if (!jsonResponse.isObject()) return false;
 
     if (loadInfo) {
-        show.description =  jsonResponse["description"].toString();
-        show.status = jsonResponse["status"].toString();
-        show.views =  jsonResponse["pageStatus"].toObject()["views"].toString();
+        show.description =  jsonResponse.at("description").toString();
+        show.status = jsonResponse.at("status").toString();
+        show.views =  jsonResponse.at("pageStatus.views").toString();
 
-        QJsonValue scoreValue = jsonResponse["score"];
-        if (!scoreValue.isUndefined() && !scoreValue.isNull()) {
+        auto scoreValue = jsonResponse.at("score");
+        if (scoreValue.isValid() && !scoreValue.isNull()) {
             show.score = QString::number(scoreValue.toDouble(), 'f', 1) + " (MAL)";
         }
 
-        QJsonValue averageScoreValue = jsonResponse["averageScore"];
-        if (!averageScoreValue.isUndefined() && !averageScoreValue.isNull()) {
+        auto averageScoreValue = jsonResponse.at("averageScore");
+        if (averageScoreValue.isValid() && !averageScoreValue.isNull()) {
             if (!show.score.isEmpty()) show.score += "; ";
             show.score += QString::number(averageScoreValue.toInt()) + " (Anilist)";
         }
 
-        QJsonArray genresArray = jsonResponse["genres"].toArray();
-        for (const QJsonValue& genreValue : genresArray) {
+        for (const auto &genreValue : jsonResponse.all("genres[*]")) {
             show.genres.push_back(genreValue.toString());
         }
 
-        QJsonObject airedStart = jsonResponse["airedStart"].toObject();
-        int day = airedStart["date"].toInt(69);
-        int month = airedStart["month"].toInt(69) + 1; // Adjusting month from 0-based to 1-based indexing
-        int year = airedStart["year"].toInt(69);
+        auto airedStart = jsonResponse.at("airedStart");
+        int day = airedStart.at("date").toInt(69);
+        int month = airedStart.at("month").toInt(69) + 1; // Adjusting month from 0-based to 1-based indexing
+        int year = airedStart.at("year").toInt(69);
         QDate airedStartDate(year, month, day);
         if (airedStartDate.isValid()){
             // Convert dayOfWeek to a string representing the day
@@ -74,16 +66,16 @@ int AllAnime::loadDetails(Client *client, ShowData &show, bool loadInfo, bool ge
             show.updateTime = airedStartDate.toString("Every dddd");
         }
 
-        if (airedStart.contains("hour")) {
-            int hour = airedStart["hour"].toInt();
-            int minute = airedStart["minute"].toInt(0);
+        if (airedStart.at("hour").isValid()) {
+            int hour = airedStart.at("hour").toInt();
+            int minute = airedStart.at("minute").toInt(0);
             show.updateTime += QString(" at %1:%2").arg(hour, 2, 10, QLatin1Char('0')).arg(minute, 2, 10, QLatin1Char('0'));
         }
     }
 
     if (!getPlaylist && !getEpisodeCount) return true;
 
-    QJsonArray episodesArray = jsonResponse["availableEpisodesDetail"].toObject()["sub"].toArray();
+    auto episodesArray = jsonResponse.all("availableEpisodesDetail.sub[*]");
     if (getPlaylist) {
         for (int i = episodesArray.size() - 1; i >= 0; --i) {
             QString episodeString = episodesArray.at(i).toString();
@@ -97,14 +89,12 @@ int AllAnime::loadDetails(Client *client, ShowData &show, bool loadInfo, bool ge
 }
 
 QList<VideoServer> AllAnime::loadServers(Client *client, const PlaylistItem *episode) const {
-    QJsonObject jsonResponse = client->get(episode->link, headers).toJsonObject();
+    auto json = client->get(episode->link, headers).json();
     QList<VideoServer> servers;
 
-    QJsonArray sourceUrls = jsonResponse["data"].toObject()["episode"].toObject()["sourceUrls"].toArray();
-    for (const QJsonValue &value : sourceUrls) {
-        QJsonObject server = value.toObject();
-        QString name = server["sourceName"].toString();
-        QString link = server["sourceUrl"].toString();
+    for (const auto &server : json.all("data.episode.sourceUrls[*]")) {
+        QString name = server.at("sourceName").toString();
+        QString link = server.at("sourceUrl").toString();
         servers.emplaceBack (name, link);
     }
 
@@ -164,15 +154,15 @@ QString AllAnime::decryptSource(const QString &input) const {
     }
 }
 
-QList<ShowData> AllAnime::parseJsonArray(const QJsonArray &showsJsonArray, bool isPopular) {
+QList<ShowData> AllAnime::parseShows(const QList<LazyJson::Value> &shows) {
     QList<ShowData> animes;
-    for (const QJsonValue& value : showsJsonArray) {
-        QJsonObject animeJson = isPopular ? value.toObject()["anyCard"].toObject() : value.toObject();
-        QString title = animeJson.value("name").toString();
-        QString link = animeJson.value("_id").toString();
+    animes.reserve(shows.size());
+    for (const auto &animeJson : shows) {
+        QString title = animeJson.at("name").toString();
+        QString link = animeJson.at("_id").toString();
         if (title.isEmpty() && link.isEmpty()) continue;
 
-        QString coverUrl = animeJson["thumbnail"].toString();
+        QString coverUrl = animeJson.at("thumbnail").toString();
         coverUrl.replace("https:/", "https://wp.youtube-anime.com");
         if (coverUrl.startsWith("images3"))
             coverUrl = "https://wp.youtube-anime.com/aln.youtube-anime.com/" + coverUrl;
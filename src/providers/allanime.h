@@ -11,6 +11,7 @@ public:
     QString name() const override { return "AllAnime"; }
     QString baseUrl = "https://allmanga.to/";
     QList<int> getAvailableTypes() const override { return {ShowData::ANIME}; }
+    QHash<QString, Client::HostLimits> getHostLimits() const override { return {{"api.allanime.day", {4, 3}}}; }
     QList<ShowData>    search       (Client *client, const QString &query, int page, int type) override;
     QList<ShowData>    popular      (Client *client, int page, int type) override;;
     QList<ShowData>    latest       (Client *client, int page, int type) override;
@@ -26,7 +27,7 @@ private:
                                       {"referer", "https://allmanga.to/"},
                                       };
     QString decryptSource(const QString& input) const;
-    QList<ShowData> parseJsonArray(const QJsonArray &showsJsonArray, bool isPopular=false);
+    QList<ShowData> parseShows(const QList<LazyJson::Value> &shows);
 };
 
 
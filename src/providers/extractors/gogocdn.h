@@ -63,7 +63,7 @@ public:
             QString encrypted =
                 client
                                     ->post(encryptedUrl,{}, {{"X-Requested-With", "XMLHttpRequest"}})
-                                    .body;
+                                    .text();
 
             QString dataEncrypted =
                 Functions::findBetween(encrypted, "{\"data\":\"", "\"}");
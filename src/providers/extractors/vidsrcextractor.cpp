@@ -102,7 +102,7 @@ QString Vidsrcextractor::encodeID(const QString &videoID, const QJsonArray &keyL
 QString Vidsrcextractor::callFromFuToken(const QString &host, const QString &data, const QString &embedLink) const {
     QMap<QString, QString> refererHeaders ;
     refererHeaders.insert("Referer", embedLink);
-    auto response = Client(nullptr).get(QString("https://%1/futoken").arg(host), refererHeaders).body;
+    auto response = Client(nullptr).get(QString("https://%1/futoken").arg(host), refererHeaders).text();
     auto fuTokenScript = response.mid(response.indexOf("window") + QString("window").length());
     fuTokenScript = fuTokenScript.mid(fuTokenScript.indexOf("function") + QString("function").length());
     fuTokenScript = fuTokenScript.remove("jQuery.ajax(");
@@ -6,8 +6,8 @@ QList<ShowData> Gogoanime::search(Client *client, const QString &query, int page
 {
     QList<ShowData> animes;
     QString url = baseUrl + "search.html?keyword=" + query + "&page=" + QString::number (page);
-    auto nodes = client->get(url).toSoup()
-                     .select("//ul[@class='items']/li/div[@class='img']/a");
+    auto doc = client->get(url).toSoup();
+    auto nodes = doc.selectRefs("//ul[@class='items']/li/div[@class='img']/a");
 
     for (auto &node : nodes) {
         QString title = node.attr("title");
@@ -22,7 +22,8 @@ QList<ShowData> Gogoanime::search(Client *client, const QString &query, int page
 QList<ShowData> Gogoanime::popular(Client *client, int page, int type) {
     QList<ShowData> animes;
     QString url = "https://ajax.gogocdn.net/ajax/page-recent-release-ongoing.html?page=" + QString::number(page);
-    auto animeNodes = client->get(url).toSoup().select ("//div[@class='added_series_body popular']/ul/li");
+    auto doc = client->get(url).toSoup();
+    auto animeNodes = doc.selectRefs("//div[@class='added_series_body popular']/ul/li");
 
     for (const auto &node:animeNodes) {
         auto anchor = node.selectFirst("a");
@@ -40,10 +41,21 @@ QList<ShowData> Gogoanime::popular(Client *client, int page, int type) {
 QList<ShowData> Gogoanime::latest(Client *client, int page, int type) {
     QList<ShowData> animes;
     QString url = "https://ajax.gogocdn.net/ajax/page-recent-release.html?page=" + QString::number(page) + "&type=1" ;
-    auto nodes = client->get(url).toSoup().select("//ul[@class='items']/li");
-
-    for (auto &node : nodes) {
-        QString coverUrl = node.selectFirst(".//img").attr("src");
+    static const CSoup::Schema schema {
+        "//ul[@class='items']/li",
+        {
+            {"cover", ".//img", "src"},
+            {"title", ".//p[@class='name']/a", {}, [](const QString &text) { return text.trimmed().replace("\n", " "); }},
+            {"latest", ".//p[@class='episode']"},
+        }
+    };
+    auto table = client->get(url).toSoup().extract(schema);
+    const auto &covers = table.column("cover");
+    const auto &titles = table.column("title");
+    const auto &latestTexts = table.column("latest");
+
+    for (int i = 0; i < table.rowCount; ++i) {
+        const QString &coverUrl = covers[i];
         static QRegularExpression re{R"(([\w-]*?)(?:-\d{10})?\.)"};
         auto lastSlashIndex = coverUrl.lastIndexOf("/");
         auto id = re.match (coverUrl.mid(lastSlashIndex + 1));
@@ -51,10 +63,8 @@ QList<ShowData> Gogoanime::latest(Client *client, int page, int type) {
             qDebug() << "Unable to extract Id from" << coverUrl.mid(lastSlashIndex+1);
             continue;
         }
-        QString title = QString(node.selectFirst(".//p[@class='name']/a").text()).trimmed().replace("\n", " ");
         QString link = "/category/" + id.captured (1);
-        QString latestText = node.selectFirst (".//p[@class='episode']").text();
-        animes.emplaceBack (title, link, coverUrl, this, latestText, ShowData::ANIME);
+        animes.emplaceBack (titles[i], link, coverUrl, this, latestTexts[i], ShowData::ANIME);
     }
     return animes;
 }
@@ -97,7 +107,8 @@ int Gogoanime::loadDetails(Client *client, ShowData &show, bool loadInfo, bool g
                        + epStart + "&ep_end="  + QString::number(lastEpisode)
                        + "&id=" + animeId + "&default_ep=0" + "&alias=" + alias;
 
-        auto episodeNodes = client->get(link).toSoup().select("//li/a");
+        auto episodesDoc = client->get(link).toSoup();
+        auto episodeNodes = episodesDoc.selectRefs("//li/a");
         if (episodeNodes.empty()) return false;
         lastEpisode = episodeNodes.size();
         for (int i=0; i<episodeNodes.size(); ++i) {
@@ -130,8 +141,8 @@ QList<VideoServer> Gogoanime::loadServers(Client *client, const PlaylistItem *ep
 {
     QList<VideoServer> servers;
     auto url = baseUrl + episode->link;
-    auto serverNodes = client->get(url).toSoup()
-                           .select("//div[@class='anime_muti_link']/ul/li/a");
+    auto doc = client->get(url).toSoup();
+    auto serverNodes = doc.selectRefs("//div[@class='anime_muti_link']/ul/li/a");
 
     for (const auto &serverNode:serverNodes) {
         QString link = serverNode.attr("data-video");
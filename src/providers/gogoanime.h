@@ -11,6 +11,9 @@ public:
     QString name() const override { return "Anitaku"; }
     QString baseUrl = "https://anitaku.to/";
     QList<int> getAvailableTypes() const override { return {ShowData::ANIME}; }
+    QHash<QString, Client::HostLimits> getHostLimits() const override {
+        return {{"anitaku.to", {4, 2}}, {"ajax.gogocdn.net", {4, 4}}};
+    }
     QList<ShowData>    search       (Client *client, const QString &query, int page, int type) override;
     QList<ShowData>    popular      (Client *client, int page, int type) override;
     QList<ShowData>    latest       (Client *client, int page, int type) override;
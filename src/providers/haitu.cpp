@@ -21,34 +21,36 @@ QList<ShowData> Haitu::filterSearch(Client *client, const QString &query, const
     QString url = baseUrl + (sortBy == "--" ? "vodsearch/": "vodshow/")
                + query + "--" + sortBy + "------" + QString::number(page) + "---.html";
 
-    auto showNodes = client->get(url).toSoup()
-        .select("//div[@class='module-list']/div[@class='module-items']/div");
+    // Search results show the serial on a link, the browse pages in a text block
+    static const CSoup::Schema schema {
+        "//div[@class='module-list']/div[@class='module-items']/div",
+        {
+            {"class", ".//div[@class='module-item-cover']//span[@class='video-class']"},
+            {"title", ".//div[@class='module-item-cover']//div[@class='module-item-pic']/img", "alt"},
+            {"cover", ".//div[@class='module-item-cover']//div[@class='module-item-pic']/img", "data-src"},
+            {"link", ".//div[@class='module-item-cover']//div[@class='module-item-pic']//a", "href"},
+            {"serial", ".//a[@class='video-serial']"},
+            {"text", ".//div[@class='module-item-text']"},
+        }
+    };
+    auto table = client->getHtml(url).toSoup().extract(schema);
+    const auto &videoClasses = table.column("class");
+    const auto &titles = table.column("title");
+    const auto &covers = table.column("cover");
+    const auto &links = table.column("link");
+    const auto &latestTexts = table.column(sortBy == "--" ? "serial" : "text");
 
     QList<ShowData> shows;
-    for (const auto &node : showNodes)
+    for (int i = 0; i < table.rowCount; ++i)
     {
-        auto moduleItemCover = node.selectFirst(".//div[@class='module-item-cover']");
-        auto videoClass = moduleItemCover.selectFirst(".//span[@class='video-class']").text();
-        if (videoClass == "伦理片") continue;
+        if (videoClasses[i] == "伦理片") continue;
 
-        auto img = moduleItemCover.selectFirst(".//div[@class='module-item-pic']/img");
-        QString title = img.attr("alt");
-        QString coverUrl = img.attr("data-src");
+        QString coverUrl = covers[i];
         if(coverUrl.startsWith ('/')) {
             coverUrl = baseUrl + coverUrl;
         }
 
-
-        QString link = moduleItemCover.selectFirst(".//div[@class='module-item-pic']//a").attr("href");
-        QString latestText;
-
-        if (sortBy == "--"){
-            latestText = node.selectFirst (".//a[@class='video-serial']").text();
-        } else {
-            latestText = node.selectFirst(".//div[@class='module-item-text']").text();
-        }
-
-        shows.emplaceBack(title, link, coverUrl, this, latestText);
+        shows.emplaceBack(titles[i], links[i], coverUrl, this, latestTexts[i]);
     }
 
     return shows;
@@ -151,7 +153,7 @@ QList<VideoServer> Haitu::loadServers(Client *client, const PlaylistItem *episod
 PlayInfo Haitu::extractSource(Client *client, const VideoServer &server) const
 {
     PlayInfo playInfo;
-    QString response = client->get(baseUrl + server.link).body;
+    QString response = client->get(baseUrl + server.link).text();
     static QRegularExpression player_aaaa_regex{R"(player_aaaa=(\{.*?\})</script>)"};
     QRegularExpressionMatch match = player_aaaa_regex.match(response);
 
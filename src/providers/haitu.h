@@ -11,6 +11,7 @@ public:
     QList<int> getAvailableTypes() const override {
         return {ShowData::ANIME, ShowData::MOVIE, ShowData::TVSERIES, ShowData::VARIETY};
     };
+    QHash<QString, int> getCacheTtls() const override { return {{"www.haituu.tv", 300}}; }
 
     QList<ShowData>    search       (Client *client, const QString &query, int page, int type) override;
     QList<ShowData>    popular      (Client *client, int page, int type) override;
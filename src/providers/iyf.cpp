@@ -113,7 +113,7 @@ QPair<QString, QString> &IyfProvider::getKeys(Client *client, bool update) const
     if (keys.first.isEmpty() || update) {
         QString url("https://www.iyf.tv/list/anime?orderBy=0&desc=true");
         static QRegularExpression pattern(R"("publicKey":"([^"]+)\","privateKey\":\[\"([^"]+)\")");
-        QRegularExpressionMatch match = pattern.match(client->get (url).body);
+        QRegularExpressionMatch match = pattern.match(client->get (url).text());
         // Perform the search
         if (!match.hasMatch() || match.lastCapturedIndex() != 2)
             throw MyException("Failed to update keys");
@@ -12,12 +12,12 @@ QVector<ShowData> Kimcartoon::search(Client *client, const QString &query, int p
 
 QVector<ShowData> Kimcartoon::popular(Client *client, int page, int type) {
     QString url = baseUrl + "CartoonList/MostPopular" + "?page=" + QString::number(page);
-    return parseResults (client->get(url).toSoup());
+    return parseResults (client->getHtml(url).toSoup());
 }
 
 QVector<ShowData> Kimcartoon::latest(Client *client, int page, int type) {
     QString url = baseUrl + "CartoonList/LatestUpdate" + "?page=" + QString::number(page);
-    return parseResults (client->get(url).toSoup());
+    return parseResults (client->getHtml(url).toSoup());
 }
 
 
@@ -129,7 +129,7 @@ PlayInfo Kimcartoon::extractSource(Client *client, const VideoServer &server) co
     }
     auto iframe = doc.selectFirst("//iframe").attr("src");
     if (iframe.startsWith ("//")) iframe = "https" + iframe;
-    auto response = client->get(iframe, {{"referer", baseUrl}}).body;
+    auto response = client->get(iframe, {{"referer", baseUrl}}).text();
     qDebug() << iframe;
     static QRegularExpression urlPattern(R"("file":"([^"]+)\")");
     auto src = urlPattern.match(response).captured(1);
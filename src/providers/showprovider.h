@@ -43,6 +43,15 @@ public:
     virtual PlayInfo           extractSource(Client *client, const VideoServer &server) const = 0;
     // virtual int getTotalEpisodes(const QString &link) const = 0;
 
+    // Hosts whose pages may be cached on disk, other hosts are never cached. Pages are revalidated with their
+    // ETag/Last-Modified, a TTL > 0 also serves them without asking, for sites that send no validators
+    virtual QHash<QString, int> getCacheTtls() const { return {}; }
+    // Connection and request rate limits per host, for sites that answer bursts with 429s or challenges
+    virtual QHash<QString, Client::HostLimits> getHostLimits() const { return {}; }
+    // Seconds extracted sources stay usable when their URLs carry no expiry of their own. Signed URLs
+    // expire on their own terms and a dead link is dropped on the first playback error, so this can be long
+    virtual int getPlayInfoTtl() const { return 2 * 60 * 60; }
+
     inline void setPreferredServer(const QString &serverName) {
         m_preferredServer = serverName;
     }
@@ -34,14 +34,20 @@ QList<ShowData> WCOFun::search(Client *client, const QString &query, int page, i
         {"catara", query},
         {"konuara", "series"}
     };
-    auto doc = client->post(url, data).toSoup();
-    auto items = doc.select("//ul[@class='items']/li/div[@class='img']/a");
-    for (const auto &item : items) {
-        auto img = item.selectFirst("./img");
-        QString coverUrl = img.attr("src");
-        QString title = img.attr("alt");
-        QString link = item.attr("href");
-        shows.emplaceBack(title, link, coverUrl, this, "", ShowData::ANIME);
+    static const CSoup::Schema schema {
+        "//ul[@class='items']/li/div[@class='img']/a",
+        {
+            {"cover", "./img", "src"},
+            {"title", "./img", "alt"},
+            {"link", ".", "href"},
+        }
+    };
+    auto table = client->post(url, data).toSoup().extract(schema);
+    const auto &covers = table.column("cover");
+    const auto &titles = table.column("title");
+    const auto &links = table.column("link");
+    for (int i = 0; i < table.rowCount; ++i) {
+        shows.emplaceBack(titles[i], links[i], covers[i], this, "", ShowData::ANIME);
     }
     return shows;
 }
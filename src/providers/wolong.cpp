@@ -5,13 +5,12 @@ QList<ShowData> Wolong::search(Client *client, const QString &query, int page, i
 {
     QList<ShowData> shows;
     QString url = baseUrl + "ac=videolist&wd=" + query + "&pg=" + QString::number (page);
-    auto list = client->get(url).toJsonObject()["list"].toArray();
+    auto list = client->get(url).json().all("list[*]");
 
-    for (const auto &item : list) {
-        auto showItem = item.toObject();
-        QString coverUrl = showItem["vod_pic"].toString();
-        QString title = showItem["vod_name"].toString();
-        QString link = QString::number(showItem["vod_id"].toInt());
+    for (const auto &showItem : list) {
+        QString coverUrl = showItem.at("vod_pic").toString();
+        QString title = showItem.at("vod_name").toString();
+        QString link = QString::number(showItem.at("vod_id").toInt());
         shows.emplaceBack(title, link, coverUrl, this, "", ShowData::ANIME);
     }
 
@@ -27,13 +26,12 @@ QList<ShowData> Wolong::latest(Client *client, int page, int type) {
     QList<ShowData> shows;
 
     QString url = "https://collect.wolongzy.cc/api.php/provide/vod/?ac=videolist&pg=" + QString::number(page) + "&t=" + QString::number(typeMap[type]);
-    auto list = client->get(url).toJsonObject()["list"].toArray();
+    auto list = client->get(url).json().all("list[*]");
 
-    for (const auto &item : list) {
-        auto showItem = item.toObject();
-        QString coverUrl = showItem["vod_pic"].toString();
-        QString title = showItem["vod_name"].toString();
-        QString link = QString::number(showItem["vod_id"].toInt());
+    for (const auto &showItem : list) {
+        QString coverUrl = showItem.at("vod_pic").toString();
+        QString title = showItem.at("vod_name").toString();
+        QString link = QString::number(showItem.at("vod_id").toInt());
         shows.emplaceBack(title, link, coverUrl, this, "", ShowData::ANIME);
     }
     return shows;
@@ -42,24 +40,24 @@ QList<ShowData> Wolong::latest(Client *client, int page, int type) {
 int Wolong::loadDetails(Client *client, ShowData &show, bool loadInfo, bool getPlaylist, bool getEpisodeCount) const
 {
     auto showItem = client->get(baseUrl + "ac=videolist&ids=" + show.link)
-                        .toJsonObject()["list"].toArray().first().toObject();
-    if (showItem.isEmpty()) return false;
+                        .json().at("list[0]");
+    if (!showItem.isObject()) return false;
 
     if (loadInfo) {
-        show.description = showItem["vod_content"].toString();
-        show.status = showItem["vod_remarks"].toString();
-        show.updateTime = showItem["vod_time"].toString();
-        show.releaseDate = showItem["vod_pubdate"].toString();
-        show.score = showItem["vod_score"].toString();
-        show.views = QString::number(showItem["vod_hits_month"].toInt());
-        auto genres = showItem["vod_class"].toString().split(",");
+        show.description = showItem.at("vod_content").toString();
+        show.status = showItem.at("vod_remarks").toString();
+        show.updateTime = showItem.at("vod_time").toString();
+        show.releaseDate = showItem.at("vod_pubdate").toString();
+        show.score = showItem.at("vod_score").toString();
+        show.views = QString::number(showItem.at("vod_hits_month").toInt());
+        auto genres = showItem.at("vod_class").toString().split(",");
         for (const auto &genre : genres) {
             show.genres.push_back(genre);
         }
     }
 
     if (!getPlaylist && !getEpisodeCount) return true;
-    auto playlist = showItem["vod_play_url"].toString().split('#');
+    auto playlist = showItem.at("vod_play_url").toString().split('#');
     int episodeCount = playlist.size();
 
     if (getPlaylist) {
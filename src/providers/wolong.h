@@ -11,6 +11,9 @@ public:
     QString baseUrl = "https://collect.wolongzy.cc/api.php/provide/vod/?";
     QString            name() const override { return "卧龙"; }
     QList<int>         getAvailableTypes() const override { return {ShowData::ANIME, ShowData::TVSERIES, ShowData::MOVIE}; }
+    QHash<QString, int> getCacheTtls() const override { return {{"collect.wolongzy.cc", 300}}; }
+    // Episode links are plain m3u8 urls that do not rotate
+    int getPlayInfoTtl() const override { return 6 * 60 * 60; }
     QList<ShowData>    search       (Client *client, const QString &query, int page, int type) override;
     QList<ShowData>    popular      (Client *client, int page, int type) override;
     QList<ShowData>    latest       (Client *client, int page, int type) override;
@@ -4,6 +4,8 @@ import QtQuick
 Item {
     property alias showTitle: showTitleText.text
     property alias showCover: showImage.source
+    property var showProviders: []
+    signal providerClicked(int providerIndex)
     // readonly property real imageAspectRatio: 319/225
 
     Image {
@@ -36,6 +38,42 @@ Item {
         }
     }
 
+    Flow {
+        // Providers the same show was found on, clicking one opens the show there
+        z: 1
+        visible: showProviders.length > 1
+        spacing: 4
+        anchors {
+            top: showImage.top
+            left: showImage.left
+            right: showImage.right
+            margins: 4
+        }
+        Repeater {
+            model: showProviders
+            delegate: Rectangle {
+                required property string modelData
+                required property int index
+                width: providerText.implicitWidth + 8
+                height: providerText.implicitHeight + 4
+                radius: 4
+                color: "#cc000000"
+                Text {
+                    id: providerText
+                    anchors.centerIn: parent
+                    text: modelData
+                    font.pixelSize: 14 * root.fontSizeMultiplier
+                    color: "white"
+                }
+                MouseArea {
+                    anchors.fill: parent
+                    cursorShape: Qt.PointingHandCursor
+                    onClicked: providerClicked(index)
+                }
+            }
+        }
+    }
+
     Text {
         id: showTitleText
         anchors {
@@ -52,8 +52,11 @@ Item {
             required property string title
             required property string cover
             required property int index
+            required property var providers
             showTitle: title
             showCover: cover
+            showProviders: providers
+            onProviderClicked: (providerIndex) => App.loadShowFrom(index, providerIndex)
             width: gridView.cellWidth
             height: gridView.cellHeight
             MouseArea{
@@ -29,6 +29,11 @@ RowLayout {
         font.pixelSize: 20 * root.fontSizeMultiplier
         activeFocusOnTab:false
         onAccepted: searchBar.search()
+        // Shift+Enter searches every provider at once
+        Keys.onReturnPressed: (event) => {
+            if (event.modifiers & Qt.ShiftModifier) App.exploreAll(searchTextField.text, 1)
+            else event.accepted = false
+        }
     }
     
     CustomButton {
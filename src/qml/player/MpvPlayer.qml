@@ -9,6 +9,7 @@ MpvObject {
     id: mpv
     property bool autoHideBars: true
     onPlayNext: App.play.playNextItem()
+    onPlaybackFailed: App.play.reportPlaybackError()
     volume: volumeSlider.value
     Component.onCompleted: {
         root.mpv = mpv